@@ -2,15 +2,169 @@
 #include <vector>
 #include <fstream>
 #include <stdio.h>
+#include <stdint.h>
 #include <string>
 #include <math.h>
 #include <limits>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <unordered_set>
+#include <map>
+#include <stdarg.h>
+
+#include "solver.h"
 
 // Global consts
-const int ROWS = 6;
-const int COLS = 3;
+const int DEFAULT_ROWS = 6; // Board size used when input.txt cannot be opened
+const int DEFAULT_COLS = 3;
+const int MAX_SQUARES = 64; // Every board has to fit in one bitboard
+
+// Build with -DDEBUG_PRINTS to print the board state along the tree search.  Like
+// SEARCH_STATS it is decided by the compiler, so there is no switch to share between threads.
+#ifdef DEBUG_PRINTS
+#define DEBUG(...) __VA_ARGS__
+#else
+#define DEBUG(...)
+#endif
+
+// Build with -DSEARCH_STATS to count nodes, cutoffs and branching per ply and print
+// them as JSON when the program ends.  Without it every STATS() line compiles away.
+#ifdef SEARCH_STATS
+#define STATS(x) x
+#else
+#define STATS(x)
+#endif
+
+const int MAX_SPLIT_PLY = 10; // Parallel search only hands out siblings this close to the root
+
+const int MAX_PLY = 256; // Longer than any game: every move takes a pawn one row closer to its goal
+const int WIN_SCORE = 100000; // Iterative deepening scores, a win for White is +WIN_SCORE
+const int TT_DEPTH_SOLVED = 32767; // Depth stored by the searches that always go to the end of the game
+
+const uint32_t PN_INFINITY = 1u << 30; // Proof and disproof numbers stop here: the position is settled
+const int PN_BUCKET = 4; // Proof table entries sharing one index, the least worked on is replaced
+const int PN_DEFAULT_MEGABYTES = 64; // Proof table size when --tt is not given
+const int MTDF_DEFAULT_MEGABYTES = 16; // MTD(f) table size when --tt is not given
+const int SHARED_BUCKET = 4; // Shared table entries sharing one index, the oldest and shallowest is replaced
+const int SHARED_BENCH_KEYS = 1 << 20; // Positions the table benchmark draws its keys from
+const uint64_t SHARED_BENCH_OPS = 1 << 23; // Lookups per thread count in the table benchmark
+
+const char CACHE_MAGIC[8] = { 'B', 'K', 'C', 'A', 'C', 'H', 'E', '1' };
+const int CACHE_BUCKET = 4; // Cache entries sharing one index, the oldest and cheapest is replaced
+const int CACHE_DEFAULT_MEGABYTES = 16; // Size of a new cache file when --cache-mb is not given
+const uint8_t CACHE_ANSWER = 1; // The entry's move is Player A's answer (first win, else last move), not just a good move
+
+const int SOLVE_DEFAULT_MEGABYTES = 16; // Table made by each Solve call, see SearchOptionsInit
+const int RACE_REPORT_BOARDS = 6;        // Generated boards per size in --race-report
+const int RACE_REPORT_PIECES = 4;        // Most pieces per side on a generated board
+const int MCTS_DEFAULT_MEGABYTES = 64; // Node pool of the Monte Carlo search when --tt is not given
+const uint64_t MCTS_DEFAULT_PLAYOUTS = 100000; // Playouts when neither --playouts nor --movetime is given
+const double MCTS_EXPLORATION = 1.41421356; // UCT constant, sqrt(2) for results between 0 and 1
+const uint32_t MCTS_EXPAND_VISITS = 8; // Playouts through a leaf before it gets children of its own
+const int MCTS_REPORT_MOVES = 8; // Root moves listed after the search, most visited first
+const int MATCH_DEFAULT_GAMES = 20; // Self-play games when --games is not given, two per opening
+const int MATCH_DEFAULT_MEGABYTES = 16; // Table per engine per game when --tt is not given
+const int MATCH_OPENING_PLIES = 2; // Random plies from the default layout that make each opening after the first
+const double MATCH_CONFIDENCE_Z = 1.96; // 95% confidence intervals on the win rates
+const int SERVER_DEFAULT_MEGABYTES = 16; // Table per worker and board size when --tt is not given
+const int SERVER_BACKLOG = 64; // Connections waiting to be accepted
+
+const uint64_t TB_MAX_POSITIONS = (uint64_t)1 << 27; // Biggest tablebase we will build, one byte per position
+const char TB_MAGIC[8] = { 'B', 'K', 'T', 'B', 'A', 'S', 'E', '1' };
+
+// Bitboards: bit (r * COLS + c) stands for square (r, c), so row 0 is the low bits
+typedef uint64_t Bitboard;
+
+// All of the squares in column c of a rows x cols board
+constexpr Bitboard ColumnMask(int rows, int cols, int c)
+{
+    return rows == 0 ? 0 : (ColumnMask(rows - 1, cols, c) | ((Bitboard)1 << ((rows - 1) * cols + c)));
+}
+
+// Target of a one square step for a piece of colour (0 White, moving up, 1 Black) on
+// square, dc columns over.  0 if the step would leave the board.
+constexpr Bitboard StepTarget(int rows, int cols, int color, int square, int dc)
+{
+    return (square % cols + dc < 0 || square % cols + dc >= cols ||
+            (color == 0 ? square / cols == 0 : square / cols == rows - 1)) ? 0
+           : (Bitboard)1 << (square + (color == 0 ? -cols : cols) + dc);
+}
+
+// 0, 1, ... N - 1 as a parameter pack, so a table can be filled in one expansion
+template <int... I> struct SquareList {};
+template <int N, int... I> struct MakeSquareList : MakeSquareList<N - 1, N - 1, I...> {};
+template <int... I> struct MakeSquareList<0, I...> { typedef SquareList<I...> Type; };
+
+// Where each piece can step to, per colour, per square: diagonal left, forward, then
+// diagonal right, in the order the moves are generated.  Built by the compiler for
+// every board size the engine is instantiated for.
+template <int R, int C, typename Squares = typename MakeSquareList<R * C>::Type> struct MoveTables;
+template <int R, int C, int... S>
+struct MoveTables<R, C, SquareList<S...> >
+{
+    static constexpr Bitboard STEPS[2][3][R * C] =
+    {
+        { { StepTarget(R, C, 0, S, -1)... }, { StepTarget(R, C, 0, S, 0)... }, { StepTarget(R, C, 0, S, 1)... } },
+        { { StepTarget(R, C, 1, S, -1)... }, { StepTarget(R, C, 1, S, 0)... }, { StepTarget(R, C, 1, S, 1)... } }
+    };
+};
+template <int R, int C, int... S> constexpr Bitboard MoveTables<R, C, SquareList<S...> >::STEPS[2][3][R * C];
+
+// Is square i in front of a pawn of colour on square, close enough to the pawn's
+// column that an enemy pawn there could still get in its way?  An enemy y rows ahead
+// meets the pawn's path at most y - 1 rows ahead of the pawn and can move one column
+// per row on the way, so only columns closer than y can block or capture it.  The
+// pawn's own column, its path to the goal row, is part of it.
+constexpr bool InRaceCone(int cols, int color, int square, int i)
+{
+    return (color == 0 ? i / cols < square / cols : i / cols > square / cols) &&
+           (i % cols > square % cols ? i % cols - square % cols : square % cols - i % cols) <
+           (color == 0 ? square / cols - i / cols : i / cols - square / cols);
+}
+
+constexpr Bitboard RaceCone(int rows, int cols, int color, int square, int i)
+{
+    return i == rows * cols ? 0 : ((InRaceCone(cols, color, square, i) ? (Bitboard)1 << i : 0) |
+                                   RaceCone(rows, cols, color, square, i + 1));
+}
+
+// The race cone of every square, per colour, for the unstoppable pawn test
+template <int R, int C, typename Squares = typename MakeSquareList<R * C>::Type> struct RaceTables;
+template <int R, int C, int... S>
+struct RaceTables<R, C, SquareList<S...> >
+{
+    static constexpr Bitboard CONES[2][R * C] =
+    {
+        { RaceCone(R, C, 0, S, 0)... },
+        { RaceCone(R, C, 1, S, 0)... }
+    };
+};
+template <int R, int C, int... S> constexpr Bitboard RaceTables<R, C, SquareList<S...> >::CONES[2][R * C];
 
-const bool DEBUG_PRINTS = false;
+// Board sizes the engine is compiled for, input.txt picks one of these at runtime
+#define SUPPORTED_BOARDS(X) \
+    X(4, 3) X(5, 3) X(6, 3) X(7, 3) X(8, 3) \
+    X(4, 4) X(5, 4) X(6, 4) X(8, 4) \
+    X(5, 5) X(6, 5) X(6, 6) X(7, 7) X(8, 8)
 
 struct Point
 {
@@ -26,16 +180,510 @@ struct Point
     }
 };
 
+struct Position
+{
+    Bitboard white;          // One bit per 'W' piece
+    Bitboard black;          // One bit per 'B' piece
+    uint64_t key;            // Zobrist key of the pieces (side to move is folded in by PositionKey)
+    uint8_t whiteCount;      // Pieces on each side, kept up to date by SetSquare and MakeMove
+    uint8_t blackCount;
+    int8_t winner;           // 1 if White has won, -1 if Black has, 0 while the game goes on
+    bool isWhitePlayer;      // Is this player 1?
+};
+
+struct Move
+{
+    int from;                // Square index moved from
+    int to;                  // Square index moved to
+    bool wins;               // Reaches the far row or takes the last enemy piece, so the game ends here
+};
+
+struct Undo
+{
+    Bitboard captured;       // Enemy piece taken by the move (0 if none)
+    uint64_t key;            // Zobrist key before the move
+    int8_t winner;           // Always 0 unless a move was made from a finished game
+};
+
+// Everything that depends on the board size.  Each size is its own instance,
+// so the masks and shift amounts below are all compile time constants.
+template <int R, int C>
+struct Board
+{
+    static_assert(R * C <= MAX_SQUARES, "The board has to fit in one bitboard");
+
+    static const int ROWS = R;
+    static const int COLS = C;
+    static const int SQUARES = R * C;
+    static const int MAX_MOVES = 3 * SQUARES; // Every piece has at most three moves
+
+    static constexpr Bitboard ALL_SQUARES = (SQUARES == 64) ? ~(Bitboard)0 : (((Bitboard)1 << SQUARES) - 1);
+    static constexpr Bitboard TOP_ROW = ((Bitboard)1 << COLS) - 1;               // Player A's goal row
+    static constexpr Bitboard BOTTOM_ROW = TOP_ROW << ((ROWS - 1) * COLS);       // Player B's goal row
+    static constexpr Bitboard FIRST_COLUMN = ColumnMask(R, C, 0);
+    static constexpr Bitboard LAST_COLUMN = ColumnMask(R, C, C - 1);
+
+    static void LoadDefaultBoard(Position &); // The initial board state from Figure 1 in the spec
+    static char GetSquare(const Position &, int, int); // 'W', 'B' or 'X' for the square at (r, c)
+    static void SetSquare(Position &, int, int, char); // Place a 'W', 'B' or 'X' at (r, c)
+    static Point SquareToPoint(int); // Convert a bit index into a (row, col) point
+    static int PointToSquare(Point); // Convert a (row, col) point into a bit index
+    static int MirrorSquare(int); // The same square with the columns flipped left to right
+    static Bitboard MirrorBits(Bitboard); // Flip every row of a bitboard left to right
+    static uint64_t CanonicalKey(const Position &, bool &mirrored); // Key of the smaller of a position and its mirror
+    static void UpdateStatus(Position &); // Recount the pieces and recheck the win conditions from scratch
+    static int CheckWinCondition(const Position &); // Return 1 if white wins, -1 if black wins
+    static int CheckNumberOfPieces(const Position &, char); // Check # of pieces for win cond
+    static int GenerateMoves(const Position &, Move *); // Fill in every legal move in search order, return the count
+    static int Evaluate(const Position &); // Guess at a position that is not over yet, White is positive
+    static int RaceWinner(const Position &); // 1 or -1 if the side to move has a pawn that can not be stopped in time, 0 if not
+};
+
+// Zobrist keys, one random number per (colour, square) plus one for Black to move
+uint64_t ZOBRIST_PIECES[2][MAX_SQUARES];
+uint64_t ZOBRIST_BLACK_TO_MOVE;
+
+enum TTFlag
+{
+    TT_EXACT,                // value is the true value of the position
+    TT_LOWER,                // search failed high, true value >= value
+    TT_UPPER                 // search failed low, true value <= value
+};
+
+struct TTEntry
+{
+    uint64_t key;            // Full Zobrist key, 0 marks an empty slot
+    int value;               // Value returned by the search
+    int16_t depth;           // Plies searched below this position, TT_DEPTH_SOLVED if to the end of the game
+    uint8_t flag;            // TTFlag
+    int8_t bestFrom;         // Square of the best move found, -1 if there was none
+    int8_t bestTo;
+};
+
+struct TranspositionTable
+{
+    std::vector<TTEntry> entries; // Power of two sized, indexed by key & mask
+    uint64_t mask;
+    uint64_t probes;         // Stats for the hit rate report
+    uint64_t hits;
+    uint64_t stores;
+};
+
+// The table the parallel search threads share, without a lock.  data packs value
+// (bits 0-15), depth (16-23), flag (24-31), generation (32-39) and best from and to
+// (40-47, 48-55).  check is key ^ data, so an entry torn by two threads writing it
+// at once reads as a miss instead of a wrong value.
+struct SharedEntry
+{
+    uint64_t check;
+    uint64_t data;
+};
+
+// Counted per thread so the counters are not shared cache lines themselves.  Padded
+// past two lines, so neighbours never meet on one whatever the vector's alignment.
+struct SharedCounters
+{
+    uint64_t probes;
+    uint64_t hits;
+    uint64_t stores;
+    uint64_t replaced;       // Stores that threw out a different position
+    uint64_t torn;           // Misses on an entry another thread was writing
+    uint64_t padding[11];
+};
+
+struct SharedTable
+{
+    std::vector<SharedEntry> entries; // Power of two buckets of SHARED_BUCKET entries
+    uint64_t mask;           // Number of buckets - 1
+    uint8_t generation;      // Bumped once per search, older entries are replaced first
+    bool mirror;             // Key on the canonical (position or mirror) form, like the serial tables
+    std::vector<SharedCounters> counters; // One per pool thread, indexed by t_threadIndex
+};
+
+struct Node;
+
+struct ChildList
+{
+    Node **items;            // Filled in all at once by FindAndMovePieces
+    unsigned int count;
+
+    unsigned int size() const { return count; }
+    Node *&operator[](unsigned int i) { return items[i]; }
+    void clear() { items = NULL; count = 0; }
+};
+
+struct MemoryStats
+{
+    uint64_t allocations;    // Separate allocations asked of the system
+    uint64_t nodes;          // Nodes created
+    uint64_t bytesInUse;
+    uint64_t peakBytes;
+};
+
+struct ArenaMark
+{
+    size_t block;            // Block that was being filled
+    size_t used;             // Bytes used in that block
+    uint64_t bytesInUse;
+};
+
+struct NodeArena
+{
+    std::vector<char *> blocks;     // Kept after a release so the memory gets reused
+    std::vector<size_t> blockSizes;
+    size_t blockSize;        // Size of a normal block, bigger requests get their own
+    size_t current;          // Block being filled
+    size_t used;             // Bytes used in the current block
+    MemoryStats stats;
+};
+
+// Tablebase values, one byte per position from the side to move's point of view:
+// 0 = not stored, 1 + d = lost in d plies, 0x80 | d = won in d plies
+const uint8_t TB_UNKNOWN = 0;
+const uint8_t TB_WIN = 0x80;
+
+struct TablebaseHeader
+{
+    char magic[8];           // TB_MAGIC
+    int32_t rows;
+    int32_t cols;
+    uint64_t positions;      // Number of value bytes after the header
+};
+
+struct Tablebase
+{
+    int rows;
+    int cols;
+    uint64_t positions;
+    const uint8_t *values;   // Points into the mapping, just past the header
+    void *mapping;           // The whole file, mapped read only
+    size_t mappingBytes;
+    uint64_t probes;
+    uint64_t hits;
+};
+
+struct CacheHeader
+{
+    char magic[8];           // CACHE_MAGIC
+    int32_t rows;
+    int32_t cols;
+    uint64_t buckets;        // Power of two, CACHE_BUCKET entries each
+    uint32_t generation;     // Bumped by every run that writes to the cache
+    uint32_t unused;
+};
+
+// data packs value (bits 0-7), best from and to (8-15, 16-23), flags (24-31),
+// generation (32-47) and work (48-63).  check is key ^ data, so an entry another
+// process is halfway through writing reads as a miss instead of a wrong answer.
+struct CacheEntry
+{
+    uint64_t check;
+    uint64_t data;
+};
+
+struct SolveCache
+{
+    const char *fileName;
+    int fd;                  // Held open for the write lock, -1 if there is no cache
+    void *mapping;           // The whole file, mapped read/write and shared with other processes
+    size_t mappingBytes;
+    CacheHeader *header;
+    CacheEntry *entries;     // Just past the header
+    uint64_t mask;           // Number of buckets - 1
+    uint16_t generation;     // Generation this run writes with
+    uint64_t probes;
+    uint64_t hits;
+    uint64_t stores;
+};
+
+struct ProofEntry
+{
+    uint64_t key;            // Full Zobrist key, 0 marks an empty slot
+    uint32_t pn;             // Proof number: how many more leaves White has to win to prove a win here
+    uint32_t dn;             // Disproof number: the same for Black
+    uint32_t work;           // Positions expanded below this one, the smallest is replaced first
+};
+
+struct ProofTable
+{
+    std::vector<ProofEntry> entries; // Power of two buckets of PN_BUCKET entries
+    uint64_t mask;           // Number of buckets - 1
+    uint64_t stores;
+};
+
+struct ProofContext
+{
+    ProofTable table;
+    Tablebase *tablebase;    // Settles positions outright, NULL for none
+    SolveCache *cache;       // Settles positions solved by earlier runs, NULL for none
+    bool mirror;             // Key the table on the canonical (position or mirror) form
+    uint64_t nodes;          // Positions expanded
+};
+
+// How much of the search AlphaBetaSearch prints
+enum TraceLevel
+{
+    TRACE_OFF,
+    TRACE_ROOT,              // Only the moves tried (and skipped) at the root
+    TRACE_FULL               // Every move, the assignment's output format
+};
+
+const char *TRACE_LEVEL_NAMES[] = { "off", "root", "full" };
+const size_t TRACE_BUFFER_BYTES = 1 << 20;
+
+struct TraceWriter
+{
+    TraceLevel level;
+    FILE *file;              // stdout unless --trace-file was given
+    char *buffer;            // Text waiting to be written, flushed when full
+    size_t used;
+};
+
+const char *ORDER_POLICY_NAMES[NUM_ORDER_POLICIES] = { "none", "tactical", "killers", "history" };
+
+// How the root of the in place search is driven
+enum RootDriver
+{
+    DRIVER_ALPHABETA,        // One full window search
+    DRIVER_PVS,              // Principal variation search: null window scouts after the first child
+    DRIVER_MTDF,             // MTD(f): null window searches against the table until the bounds meet
+    NUM_ROOT_DRIVERS
+};
+
+const char *ROOT_DRIVER_NAMES[NUM_ROOT_DRIVERS] = { "alphabeta", "pvs", "mtdf" };
+
+// How an engine of a self-play match picks its moves
+enum EngineKind
+{
+    ENGINE_SOLVE,            // In place alpha-beta to the end of the game
+    ENGINE_DEPTH,            // Iterative deepening to a number of plies
+    ENGINE_TIME,             // Iterative deepening for a number of ms a move
+    ENGINE_MCTS,             // Monte Carlo tree search with a number of playouts a move
+    ENGINE_RANDOM,           // Any legal move
+    NUM_ENGINE_KINDS
+};
+
+const char *ENGINE_KIND_NAMES[NUM_ENGINE_KINDS] = { "solve", "depth", "time", "mcts", "random" };
+
+struct MoveOrdering
+{
+    OrderPolicy policy;
+    Move killers[MAX_PLY][2]; // Last two quiet moves that caused a cutoff at each ply
+    uint32_t history[MAX_SQUARES][MAX_SQUARES]; // Cutoffs caused by each (from, to), weighted by depth
+    uint64_t nodes;          // Positions searched with this ordering
+};
+
+struct SearchContext
+{
+    TranspositionTable *tt;  // NULL to search without a transposition table
+    NodeArena *arena;        // NULL to allocate Nodes with new
+    bool releaseSubtrees;    // Give a child's subtree back to the arena once it is searched
+    MoveOrdering *ordering;  // NULL keeps the generation order (in place search only)
+    Tablebase *tablebase;    // NULL to search without the tablebase
+    TraceWriter *trace;      // NULL prints the full trace straight to stdout
+    bool mirror;             // Key the table on the canonical (position or mirror) form
+    SolveCache *cache;       // Solved positions from earlier runs, NULL for none
+    bool scout;              // Search children after the first with a null window, and again only if it fails inside (a, b)
+    bool race;               // End the search at positions RaceWinner settles
+};
+
 struct Node
 {
     struct Point movedFrom;  // Point Moved From
     struct Point movedTo;    // Point Moved To
     Node *whiteWinNode;      // Will be set the first time a node receives a "1" from a child
-    std::vector<Node *> children; // List of Children
-    char boardState[ROWS][COLS];   // Board State (rows x cols)
-    bool isWhitePlayer;      // Is this player 1?
+    ChildList children;      // List of Children
+    Position position;       // Board State (two bitboards + player to move)
+};
+
+struct CancelScope
+{
+    const CancelScope *parent; // Scope of the split point above this one, NULL at the top
+    std::atomic<bool> cancelled; // Set on a cutoff, stops everything searching under this scope
+
+    CancelScope() : parent(NULL), cancelled(false) {}
+};
+
+struct WorkQueue
+{
+    std::mutex lock;
+    std::deque<std::function<void()> > tasks;
+};
+
+struct ThreadPool
+{
+    int numThreads;          // Workers plus the thread that made the pool
+    std::vector<std::thread> workers;
+    std::vector<WorkQueue *> queues; // One per thread, queue 0 belongs to the thread that made the pool
+    std::mutex sleepLock;
+    std::condition_variable wakeUp;
+    std::atomic<int> pending; // Tasks queued but not yet started
+    std::atomic<bool> stop;
+};
+
+struct SplitPoint
+{
+    CancelScope scope;       // Cancelled when a sibling fails high
+    std::mutex lock;         // Guards everything below
+    Position position;       // Position at the node being split
+    Move moves[3 * MAX_SQUARES];
+    int numMoves;
+    int nextMove;            // Next sibling to hand out
+    int a;                   // Window shared by every thread working here
+    int b;
+    int ply;
+    SharedTable *table;      // NULL to search without the shared table
+    std::atomic<int> activeHelpers; // Helper tasks submitted but not finished
+};
+
+struct IterativeContext
+{
+    TranspositionTable *tt;  // NULL to search without a transposition table
+    bool hasDeadline;        // Is there a --movetime budget?
+    std::chrono::steady_clock::time_point deadline;
+    bool aborted;            // Ran out of time, the current iteration is thrown away
+    bool hitHorizon;         // Some position was scored with Evaluate, so the result is not proven
+    uint64_t nodes;
+    Move pv[MAX_PLY][MAX_PLY]; // Principal variation found at each ply (triangular)
+    int pvLength[MAX_PLY];
+    Move previousPv[MAX_PLY]; // PV of the last completed iteration, searched first in the next one
+    int previousPvLength;
+    bool followPv;           // Still walking down the previous PV
+    MoveOrdering *ordering;  // NULL keeps the generation order
+    bool mirror;             // Key the table on the canonical (position or mirror) form
 };
 
+#ifdef SEARCH_STATS
+const int STATS_CUTOFF_INDICES = 8; // Cutoffs at this move index or later share the last bucket
+
+struct SearchStats
+{
+    uint64_t nodes[MAX_PLY];    // Positions the serial searches entered at each ply
+    uint64_t children[MAX_PLY]; // Moves generated at each ply
+    uint64_t cutoffs[MAX_PLY];  // Searches at each ply that failed high (b <= a)
+    uint64_t cutoffAtIndex[MAX_PLY][STATS_CUTOFF_INDICES]; // Which move caused them
+    uint64_t terminal[MAX_PLY]; // Positions where the game was already won
+    int deepestPly;
+    std::chrono::steady_clock::time_point start;
+};
+#endif
+
+// One position of the Monte Carlo tree.  A node's children sit next to each other in
+// the pool, so it only keeps the index of the first.  visits is counted on the way
+// down and wins on the way back up, so a playout still running through a node reads
+// as a loss there (the virtual loss) and steers the other threads elsewhere.
+struct MctsNode
+{
+    std::atomic<uint32_t> visits; // Playouts through this node, finished or not
+    std::atomic<uint32_t> wins;   // Playouts won by the side that made the move into this node
+    std::atomic<uint32_t> firstChild; // Pool index of the first child, 0 until it is expanded
+    std::atomic<bool> expanding;  // Claimed by the thread expanding it (or found the pool full)
+    uint8_t numChildren;     // Written before firstChild is published
+    int8_t from;             // Move into this node
+    int8_t to;
+    bool ends;               // The move wins the game on the spot (Move::wins)
+};
+
+struct MctsTree
+{
+    MctsNode *nodes;         // The pool, node 0 is the root
+    uint32_t capacity;
+    std::atomic<uint32_t> used; // Nodes handed out so far
+    std::atomic<uint64_t> playouts; // Playouts started, every thread stops at maxPlayouts
+    uint64_t maxPlayouts;    // 0 for no limit
+    bool hasDeadline;        // Is there a --movetime budget?
+    std::chrono::steady_clock::time_point deadline;
+};
+
+struct MatchEngine
+{
+    const char *name;        // As given on the command line, e.g. mcts:20000
+    EngineKind kind;
+    uint64_t limit;          // Plies, ms or playouts a move, depending on kind
+};
+
+struct MatchGame
+{
+    int opening;             // Index into the openings
+    int whiteEngine;         // 0 if the first engine played White, 1 if the second did
+    int winner;              // Engine that won
+    int plies;
+    int moves[2];            // Per engine
+    uint64_t nodes[2];       // Positions searched (playouts for mcts)
+    double milliseconds[2];
+};
+
+struct BatchBoard
+{
+    std::string name;        // File name, or the batch file and board number
+    std::vector<std::string> lines; // One line per row
+    SolveResult result;
+};
+
+// What a library caller keeps between Solve calls, see solver.h
+struct SolverContext
+{
+    std::map<int, TranspositionTable *> tables; // Warm table per board size and mirror setting, keyed by (rows * 100 + cols) * 2 + mirror
+};
+
+// What one server thread keeps between requests
+struct ServerWorker
+{
+    std::map<int, TranspositionTable *> tables; // Warm table per board size, keyed by rows * 100 + cols
+};
+
+struct ServerState
+{
+    std::vector<ServerWorker> workers; // One per pool thread, indexed by t_threadIndex
+    const Tablebase *tablebase; // Used for the boards it matches, NULL for none
+    std::atomic<bool> stopping; // A client asked the server to shut down
+    int listenFd;            // -1 when serving stdin
+    std::mutex clientsLock;  // Guards clients
+    std::unordered_set<int> clients; // Open connections, shut down with the server
+};
+
+struct SolverOptions
+{
+    int ttMegabytes;         // 0 means no transposition table
+    bool inPlace;            // Search with make/unmake instead of building the tree
+    bool useArena;           // Take Nodes from a NodeArena instead of new
+    bool keepTree;           // Keep the whole tree in the arena instead of releasing searched subtrees
+    bool memoryStats;        // Report peak memory and allocation counts
+    int threads;             // 0 searches serially, otherwise the parallel search uses this many threads
+    bool speedup;            // Time the parallel search at 1, 2, 4, ... threads
+    bool tableBench;         // Time shared table lookups at 1, 2, 4, ... threads
+    int maxDepth;            // Iterative deepening depth limit, 0 for none
+    int moveTime;            // Iterative deepening time budget in ms, 0 for none
+    OrderPolicy order;       // Move ordering for the in place and iterative deepening searches
+    RootDriver driver;       // Root driver of the in place search
+    bool race;               // Stop at positions with an unstoppable pawn (tree and in place searches)
+    bool raceReport;         // Count the nodes the race test saves on the bundled and generated boards
+    bool mcts;               // Pick a move with Monte Carlo tree search instead of solving the board
+    uint64_t playouts;       // Monte Carlo playout limit, 0 for none
+    const char *match[2];    // Engines of a self-play match, NULL for no match
+    int matchGames;          // Games of the match
+    bool quiet;              // Leave out the per iteration and per move lines (self-play games print only the totals)
+    bool orderReport;        // Count the nodes each ordering policy needs to solve the board
+    const char *tablebaseFile; // Tablebase to probe while searching, NULL for none
+    const char *buildTablebase; // Build the tablebase for the input.txt board size into this file and exit
+    const char *batch;       // Solve every board in this file or directory instead of input.txt
+    TraceLevel traceLevel;   // How much of the tree search to print
+    const char *traceFile;   // Write the trace here instead of stdout, NULL for stdout
+    bool proofNumber;        // Solve with depth-first proof-number search instead of alpha-beta
+    bool mirror;             // Share table entries between a position and its left-right mirror
+    const char *cacheFile;   // Persistent solve cache shared across runs, NULL for none
+    int cacheMegabytes;      // Size of the cache file if it has to be created
+    bool serve;              // Stay up answering boards from stdin, or from socketPath
+    const char *socketPath;  // Unix domain socket to serve on, NULL for stdin
+    int perftDepth;          // Count the leaves at depth 1 to N instead of solving, 0 for none
+    bool divide;             // Also break the deepest perft count down by root move
+};
+
+MemoryStats g_heapStats;     // What the Nodes made with new have cost so far
+#ifdef SEARCH_STATS
+thread_local SearchStats g_searchStats; // Per thread, so batch and parallel workers do not race the main thread
+#endif
+
 /* Design Stuff:
 1.  Check win condition -> Stops recursion - DONE
     A.  Black Team
@@ -150,515 +798,5395 @@ D.  Test a 1 v 1 pawn simulation
 E.  Do a-B pruning with 1 v 1
 */
 
-bool LoadFile(Node*); // Load in the initial board state
-bool LoadFileCustom(Node*, std::string); // Load in the initial board state
-void PrintList(Node*); // Print the board state of the node in question
-int CheckWinCondition(Node *); // Return 1 if white wins, -1 if black wins
-int CheckNumberOfPieces(Node *, char); // Check # of pieces for win cond
-void FindAndMovePieces(Node *); // Loop through the array and find all playable pieces for a player
-void CreateChildren(Node *, Point); // Create all of the valid children of a current node
-Point CreateForwardPoint(Node *, Point); // Will create a forward movement point, if it is valid
-Point CreateDiagonalPoint(Node *, Point, bool); // Will create a left or right diagonal move, if it is valid
-void CreateChild(Node *, Point, Point); // Create a child of a current board state
-void Tests(Node *); // Tests for tree functionality
-int AlphaBetaSearch(Node *, int a, int b); // Search Algorithm + Pruning
-
-int main()
+template <int R, int C> bool LoadFile(Node*); // Load in the initial board state
+template <int R, int C> bool LoadFileCustom(Node*, std::string); // Load in the initial board state
+bool ReadBoardSize(std::string, int &rows, int &cols); // Find the board size a file holds
+template <int R, int C> void LoadLines(Position &, const std::vector<std::string> &); // Read a board from its rows
+bool ReadBatch(const char *, std::vector<BatchBoard> &); // Boards from a file of blank line separated blocks, or a directory of files
+template <int R, int C> void SolveLines(const std::vector<std::string> &, const SearchOptions &, TranspositionTable *, const Tablebase *, SolveResult &); // What Solve and the batch and server modes all search with
+template <int R, int C> void PrincipalVariation(const Position &, Move first, SearchContext *, std::vector<SolveMove> &); // first, then the best move of each position to the end of the game
+template <int R, int C> void SolveBatchBoard(BatchBoard &, const SolverOptions &, const Tablebase *); // Solve one board of a batch
+void SolveBatchBoardAnySize(BatchBoard &, const SolverOptions &, const Tablebase *); // Pick the engine for the board's size
+int RunBatch(const SolverOptions &); // Solve a batch on the thread pool and print one line per board
+void RaceBoard(int rows, int cols, uint64_t &seed, std::vector<std::string> &lines); // A random sparse board for --race-report
+int RaceReport(const SolverOptions &); // Solve the bundled and generated boards with and without RaceWinner
+template <int R, int C> void SolveBatchBoard(BatchBoard &, const SolverOptions &, const Tablebase *, TranspositionTable *); // Same, searching with a table kept from earlier boards
+bool SolveServerBoard(BatchBoard &, const SolverOptions &, ServerState &, ServerWorker &); // Solve a request with the worker's warm table, false if the size is not supported
+bool ServeLines(FILE *in, FILE *out, const SolverOptions &, ServerState &, ServerWorker &); // Answer boards one line at a time until end of input, true on shutdown
+void ServeClient(int fd, const SolverOptions *, ServerState *); // Pool task: one socket connection
+int RunServer(const SolverOptions &); // Serve boards from stdin or a Unix domain socket until told to stop
+bool TraceOpen(TraceWriter &, TraceLevel, const char *fileName); // Start a trace, fileName NULL for stdout
+bool TraceEnabled(const TraceWriter *, int ply); // Does a node at this ply print anything?
+void TracePrint(TraceWriter *, const char *format, ...); // printf into the trace buffer
+void TraceFlush(TraceWriter *); // Write out whatever is buffered
+void TraceClose(TraceWriter &); // Flush, and close the file if there is one
+template <int R, int C> void PrintList(Node*); // Print the board state of the node in question
+template <int R, int C> void PrintList(Node*, TraceWriter *); // Same, into the trace so it stays in order with the trace lines
+Position ApplyMove(const Position &, Move); // Return the position after a move is made
+void AddMove(Move *, int &numMoves, int from, Bitboard target, Bitboard winning); // Append the move to target if there is one, flagging it if it wins
+void MakeMove(Position &, Move, Undo &); // Make a move in place, saving what UnmakeMove needs
+void UnmakeMove(Position &, Move, const Undo &); // Take back a move made by MakeMove
+void MoveToFront(Move *, int numMoves, int from, int to); // Search this move first
+void OrderingInit(MoveOrdering &, OrderPolicy); // Clear the killers, history and node count
+MoveOrdering *OrderingCreate(OrderPolicy); // A new, cleared ordering (big enough to want it off the stack)
+SearchOptions SolverSearchOptions(const SolverOptions &); // The part of the command line options a search takes
+void SearchContextInit(SearchContext &, const SearchOptions &, TranspositionTable *, MoveOrdering *); // Set every field: the options' mirror and race, the table and ordering given, nothing else attached
+int DefaultThreads(const SolverOptions &); // --threads N, or every core if it was not given
+template <int R, int C> void OrderMoves(const Position &, Move *, int numMoves, int ply, const MoveOrdering *); // Sort moves by the policy, best first
+void RecordCutoff(MoveOrdering *, const Position &, Move, int ply, int weight); // Update the killers and history after a cutoff
+template <int R, int C> void OrderingReport(const Position &, const SolverOptions &); // Solve once per policy and compare node counts
+template <int R, int C> uint64_t Perft(Position &, int depth); // Count the positions exactly depth plies away with make/unmake
+template <int R, int C> uint64_t PerftTree(Node *, int depth, NodeArena &); // Same count, building the children with FindAndMovePieces
+template <int R, int C> void PerftReport(const Position &, int maxDepth, bool divide); // Time perft at depth 1 to maxDepth and check both generators agree
+template <int R, int C> uint64_t TablebaseSize(); // Positions in the tablebase for this board, 0 if it is too big to build
+template <int R, int C> uint64_t TablebaseIndex(const Position &); // Index of a position that is not over yet
+template <int R, int C> Position TablebasePosition(uint64_t); // The position stored at an index
+template <int R, int C> int BuildTablebase(const char *, int threads); // Retrograde solve every position and write the file
+template <int R, int C> int TablebaseProbe(Tablebase &, const Position &, int *distance); // 1 or -1 for a White or Black win, 0 if not stored
+bool TablebaseLoad(Tablebase &, const char *); // Map a tablebase file into memory
+bool CacheOpen(SolveCache &, const char *, int rows, int cols, int megabytes); // Map the cache file, creating it if it is new
+bool CacheProbe(SolveCache &, uint64_t key, int &value, int &bestFrom, int &bestTo, uint8_t &flags); // Look a position up
+bool CacheBeginWrite(SolveCache &); // Take the file lock and start a new generation
+void CacheStore(SolveCache &, uint64_t key, int value, int bestFrom, int bestTo, uint8_t flags, uint64_t work); // Replaces the oldest, then cheapest entry
+void CacheStoreTable(SolveCache &, const TranspositionTable &, int winValue); // Store every proven result in the table
+void CacheStoreProofTable(SolveCache &, const ProofTable &); // Store every proof and disproof
+void CacheEndWrite(SolveCache &); // Drop the file lock
+void CacheClose(SolveCache &); // Unmap the file
+void TablebaseUnload(Tablebase &); // Unmap it again
+int TablebaseDistance(uint8_t); // Plies to the end of the game stored in a tablebase value
+template <int R, int C> void FindAndMovePieces(Node *); // Find all playable pieces for a player and create their children
+template <int R, int C> void FindAndMovePieces(Node *, NodeArena *); // Same, taking the children from an arena (NULL for new)
+template <int R, int C> void CreateChild(Node *, Move, NodeArena *); // Create a child of a current board state
+void ArenaInit(NodeArena &, size_t blockSize); // Set up an empty arena
+void *ArenaAlloc(NodeArena &, size_t bytes); // Bump allocate from the current block
+ArenaMark ArenaGetMark(const NodeArena &); // Remember how full the arena is
+void ArenaRelease(NodeArena &, ArenaMark); // Free everything allocated since the mark in O(1)
+void ArenaReset(NodeArena &); // Free everything, keeping the blocks for the next solve
+void ArenaFree(NodeArena &); // Give the blocks back to the system
+void PrintMemoryStats(const char *, const MemoryStats &); // Report peak memory and allocation counts
+#ifdef SEARCH_STATS
+void StatsNode(int ply, bool terminal); // Count a node, and whether the game was over there
+void StatsChildren(int ply, int numMoves); // Count the moves generated at a node
+void StatsCutoff(int ply, int index); // Count a fail high caused by the move at index
+void StatsReport(int rows, int cols); // Print the counters as JSON
+#endif
+template <int R, int C> void Tests(Node *); // Tests for tree functionality
+template <int R, int C> int RunSolver(const SolverOptions &); // Load input.txt, search it and print the results
+template <int R, int C> int AlphaBetaSearch(Node *, int a, int b); // Search Algorithm + Pruning
+template <int R, int C> int AlphaBetaSearch(Node *, int a, int b, SearchContext *, int ply); // Same, with a transposition table
+template <int R, int C> int SearchChild(Node *, int a, int b, SearchContext *, int ply, bool release); // Search a child, then release its subtree
+template <int R, int C> int InPlaceSearch(Position &, int a, int b, SearchContext *, int ply, Move *rootMove); // a-B with make/unmake, no tree
+template <int R, int C> int MtdfSearch(Position &, int guess, SearchContext *, Move *rootMove, int &passes); // Null window passes until the value is pinned down
+template <int R, int C> int DriverSearch(Position &, RootDriver, SearchContext *, Move *rootMove, int &passes); // Solve the root with the chosen driver
+template <int R, int C> std::string DriverComparison(const Position &, const SolverOptions &, const SearchContext &, uint64_t nodes, int passes); // Solve again with plain alpha-beta and compare nodes
+bool TTCutoff(const TTEntry &, int a, int b); // Does the stored bound settle the window?
+TTFlag BoundFlag(int value, int alphaOrig, int betaOrig); // What kind of bound a fail-hard result is
+uint64_t SplitMix64(uint64_t &state); // Next number of a splitmix64 sequence
+void InitZobristKeys(); // Fill in the Zobrist key tables
+uint64_t PositionKey(const Position &); // Zobrist key of the board plus side to move
+template <int R, int C> uint64_t TableKey(const Position &, bool mirror, bool &mirrored); // Canonical key if mirror is on, PositionKey if not
+void TTInit(TranspositionTable &, int megabytes); // Allocate and clear the table
+bool TTProbe(TranspositionTable &, uint64_t key, TTEntry &); // Copy out the entry for key if it is stored
+void TTStore(TranspositionTable &, uint64_t key, int value, int depth, TTFlag, int bestFrom, int bestTo); // Always replaces
+void SharedInit(SharedTable &, int megabytes, int threads, bool mirror); // Allocate and clear the shared table, with counters for threads threads
+void SharedNewSearch(SharedTable &); // Start a generation: what the last search stored goes first
+bool SharedProbe(SharedTable &, uint64_t key, TTEntry &); // Copy out the entry for key if it is stored, from any thread
+void SharedStore(SharedTable &, uint64_t key, int value, int depth, TTFlag, int bestFrom, int bestTo); // Replaces the oldest, then shallowest entry
+SharedCounters SharedTotals(const SharedTable &); // Every thread's counters added up
+void SharedBenchmark(int megabytes, int maxThreads); // Time lookups per second at 1, 2, 4, ... threads
+template <int R, int C> void MoveChildToFront(Node *, int from, int to); // Search the child made by this move first
+template <int R, int C> int ParallelRootSearch(Position &, ThreadPool *, SharedTable *, Move *rootMove); // Young Brothers Wait search of the root
+template <int R, int C> int ParallelSearch(Position &, int a, int b, int ply, const CancelScope *, ThreadPool *, SharedTable *); // Young Brothers Wait a-B
+template <int R, int C> int SplitSearch(const Position &, const Move *, int first, int numMoves, int a, int b, int ply, const CancelScope *, ThreadPool *, SharedTable *); // Share the younger brothers out
+template <int R, int C> void WorkOnSplitPoint(SplitPoint *, ThreadPool *); // Search siblings from a split point until none are left
+template <int R, int C> void SpeedupReport(const Position &, int maxThreads, const SolverOptions &); // Time the parallel search at 1, 2, 4, ... threads, with a --tt table if one was asked for
+int SpeedupReportFiles(const SolverOptions &); // The speedup table for each bundled case file and input.txt
+template <int R, int C> int IterativeDeepening(Position &, const SolverOptions &, TranspositionTable *, MoveOrdering *, Move *rootMove); // Deepen until proven or out of depth/time
+template <int R, int C> int DepthLimitedSearch(Position &, int a, int b, int depth, int ply, IterativeContext *); // a-B that stops at the horizon
+void ProofTableInit(ProofTable &, int megabytes); // Allocate and clear the proof table
+bool ProofTableProbe(const ProofTable &, uint64_t key, uint32_t &pn, uint32_t &dn); // Look up the numbers stored for key
+void ProofTableStore(ProofTable &, uint64_t key, uint32_t pn, uint32_t dn, uint64_t work); // Replaces the entry with the least work
+template <int R, int C> void ProofNumbers(ProofContext *, const Position &, uint32_t &pn, uint32_t &dn); // Numbers of a position, 1 and 1 if nothing is known
+template <int R, int C> void ProofNumberSearch(Position &, uint32_t thresholdPn, uint32_t thresholdDn, ProofContext *); // df-pn: expand until a threshold is reached
+template <int R, int C> int ProofNumberSolve(Position &, ProofContext *); // Run df-pn until the position is settled, 1 if White wins, -1 if Black does
+template <int R, int C> int ProofNumberRoot(Position &, ProofContext *, Move *rootMove); // Solve the root's children in order, stopping at Player A's first win
+template <int R, int C> uint64_t ProofTreeSize(Position &, ProofContext *, std::unordered_set<uint64_t> &); // Positions in the proof (or disproof) tree
+bool IsCancelled(const CancelScope *); // Has this scope or any scope above it been cancelled?
+void PoolInit(ThreadPool &, int numThreads); // Start numThreads - 1 workers
+void PoolSubmit(ThreadPool &, std::function<void()>); // Queue a task on the calling thread's queue
+bool PoolRunPending(ThreadPool &); // Run one queued task, own queue first then stealing, false if there was none
+void PoolWorker(ThreadPool *, int index); // Worker thread loop
+void PoolShutdown(ThreadPool &); // Stop and join the workers
+void PoolParallelFor(ThreadPool &, uint64_t count, std::function<void(uint64_t, uint64_t)>); // Run [0, count) in chunks on the pool and wait
+template <int R, int C> int MctsSearch(const Position &, const SolverOptions &, Move *rootMove, uint64_t &playouts, std::string &summary); // Most visited root move after the playouts, 1 if it wins outright, 0 if not proven
+template <int R, int C> void MctsWorker(MctsTree *, const Position &, uint64_t seed); // Run playouts until a limit is reached
+template <int R, int C> void MctsPlayout(MctsTree *, const Position &, uint64_t &rng); // Select down the tree, expand, roll out and back the result up
+template <int R, int C> bool MctsExpand(MctsTree *, MctsNode &, const Position &); // Give a node its children, false if another thread has or the pool is full
+template <int R, int C> int MctsRollout(Position &, uint64_t &rng); // Random game to the end, taking wins when there are any; 1 if White wins, -1 if Black does
+bool ParseEngine(const char *, MatchEngine &); // Read kind[:limit], false if it is not one
+template <int R, int C> int RunMatch(const SolverOptions &); // Play the two --match engines against each other and print the totals
+template <int R, int C> void MatchOpening(int index, Position &); // The default layout, then layouts a few random plies into the game
+template <int R, int C> void PlayMatchGame(const SolverOptions &, const MatchEngine *engines, const Position &opening, MatchGame &); // Play one game to the end
+template <int R, int C> Move EngineMove(const SolverOptions &, const MatchEngine &, const Position &, TranspositionTable *, uint64_t &rng, uint64_t &nodes); // The engine's move for the side to move
+void WilsonInterval(int wins, int games, double &low, double &high); // Confidence interval of a win rate
+
+#ifndef SOLVER_LIBRARY
+int main(int argc, char *argv[])
 {
-    // Create the initial node:
-    Node* startNode = new Node();
-    startNode->isWhitePlayer = true;
-    LoadFileCustom(startNode, "input.txt");
-    if (DEBUG_PRINTS) PrintList(startNode);
-    //Tests(startNode);
-    int winInt = AlphaBetaSearch(startNode, std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
-
-    std::cout << std::endl << "-----Expansions Complete-----" << std::endl;
-
-    std::cout << std::endl << "----------------RESULTS-----------------"<< std::endl;
-
-    printf("Answer:  Player A moves the piece at (%d, %d) to (%d, %d).\n",
-           startNode->whiteWinNode->movedFrom.r, startNode->whiteWinNode->movedFrom.c,
-           startNode->whiteWinNode->movedTo.r, startNode->whiteWinNode->movedTo.c
-    );
-
-    std::cout << "Alpha Beta Search Result: " << winInt << std::endl;
-
-    return 0;
-}
-
-int AlphaBetaSearch(Node *n, int a, int b)
-{
-    // Check the win conditions
-    int winInt = CheckWinCondition(n);
-    if (winInt != 0)
-    {
-        if (DEBUG_PRINTS) printf("Win value found, returning %d.\n", winInt);
-        return winInt;
-    }
-    else
+    STATS(g_searchStats.start = std::chrono::steady_clock::now());
+
+    SolverOptions options;
+    options.ttMegabytes = 0;
+    options.inPlace = false;
+    options.useArena = false;
+    options.keepTree = false;
+    options.memoryStats = false;
+    options.threads = 0;
+    options.speedup = false;
+    options.tableBench = false;
+    options.maxDepth = 0;
+    options.moveTime = 0;
+    options.order = ORDER_NONE;
+    options.driver = DRIVER_ALPHABETA;
+    options.race = false;
+    options.raceReport = false;
+    options.mcts = false;
+    options.playouts = 0;
+    options.match[0] = NULL;
+    options.match[1] = NULL;
+    options.matchGames = MATCH_DEFAULT_GAMES;
+    options.quiet = false;
+    options.orderReport = false;
+    options.tablebaseFile = NULL;
+    options.buildTablebase = NULL;
+    options.batch = NULL;
+    options.traceLevel = TRACE_FULL;
+    options.traceFile = NULL;
+    options.proofNumber = false;
+    options.mirror = true;
+    options.cacheFile = NULL;
+    options.cacheMegabytes = CACHE_DEFAULT_MEGABYTES;
+    options.serve = false;
+    options.socketPath = NULL;
+    options.perftDepth = 0;
+    options.divide = false;
+
+    for (int i = 1; i < argc; i++)
     {
-        // Create the children first
-        // Find and Move Pieces finds all of the pieces
-        // of the current player, and then creates children
-        // from all of them.  Then, for each of those children
-        // we recurse through a-B pruning until a <= B
-        FindAndMovePieces(n);
-
-        // Loop through all children and expand through tree
-        for (unsigned int i = 0; i < n->children.size(); i++) // For each child
+        if (strcmp(argv[i], "--tt") == 0 && i + 1 < argc)
         {
-            if (n->isWhitePlayer) // Maximizing Player
-            {
-                if (b > a)
-                {
-                    printf("Player A moves the piece at (%d,%d) to (%d,%d).\n", n->children[i]->movedFrom.r, n->children[i]->movedFrom.c, n->children[i]->movedTo.r, n->children[i]->movedTo.c);
-                    if (DEBUG_PRINTS) PrintList(n->children[i]);
-                    a = std::max(a, AlphaBetaSearch(n->children[i], a, b));
-
-                    if ((a == 1 || i == n->children.size() - 1) && n->whiteWinNode == NULL)
-                    {
-                        // Get first reference to winning move or just the last move if there is no good one
-                        // This is done specifically for White Player, or P1, to satisfy the first move problem
-                        // as outlined in the assignment 3 document
-                        n->whiteWinNode = n->children[i];
-                    }
-
-                    if (b <= a && i != n->children.size() - 1) // Start off the print sequence if true
-                    {
-                        printf("Skipping Player A's moves: ");
-                    }
-                }
-                else
-                {
-                    printf("(%d,%d) to (%d,%d)", n->children[i]->movedFrom.r, n->children[i]->movedFrom.c, n->children[i]->movedTo.r, n->children[i]->movedTo.c);
-                    if (i == n->children.size() - 1)
-                    {
-                        printf("; Alpha = %d, Beta = %d.\n", a, b);
-                    }
-                    else
-                    {
-                        printf(", ");
-                    }
-                }
-            }
-            else // Minimizing Player
-            {
-                if (b > a)
-                {
-                    printf("Player B moves the piece at (%d,%d) to (%d,%d).\n", n->children[i]->movedFrom.r, n->children[i]->movedFrom.c, n->children[i]->movedTo.r, n->children[i]->movedTo.c);
-                    if (DEBUG_PRINTS) PrintList(n->children[i]);
-                    b = std::min(b, AlphaBetaSearch(n->children[i], a, b));
-
-                    if ((b == 1 || i == n->children.size() - 1) && n->whiteWinNode == NULL)
-                    {
-                        // Get first reference to winning move or just the last move if there is no good one
-                        // This is done specifically for White Player, or P1, to satisfy the first move problem
-                        // as outlined in the assignment 3 document
-                        n->whiteWinNode = n->children[i];
-                    }
-
-                    if (b <= a && i != n->children.size() - 1) // Start off the print sequence if true
-                    {
-                        printf("Skipping Player B's moves: ");
-                    }
-                }
-                else// Start off the print sequence if true
-                {
-                    printf("(%d,%d) to (%d,%d)", n->children[i]->movedFrom.r, n->children[i]->movedFrom.c, n->children[i]->movedTo.r, n->children[i]->movedTo.c);
-                    if (i == n->children.size() - 1)
-                    {
-                        printf("; Alpha = %d, Beta = %d.\n", a, b);
-                    }
-                    else
-                    {
-                        printf(", ");
-                    }
-                }
-            }
-
-            //printf("Alpha: %d, Beta: %d\n", a, b);
+            options.ttMegabytes = atoi(argv[++i]);
         }
-
-        // Return the appropriate value
-        if (n->isWhitePlayer)
+        else if (strcmp(argv[i], "--inplace") == 0)
         {
-            return a;
+            options.inPlace = true;
         }
-        else
+        else if (strcmp(argv[i], "--arena") == 0)
         {
-            return b;
+            options.useArena = true;
         }
-    }
-}
-
-void PrintList(Node *n)
-{
-    for (int i = 0; i < ROWS; i++)
-    {
+        else if (strcmp(argv[i], "--keep-tree") == 0)
+        {
+            options.keepTree = true;
+        }
+        else if (strcmp(argv[i], "--memstats") == 0)
+        {
+            options.memoryStats = true;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            options.threads = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--speedup") == 0)
+        {
+            options.speedup = true;
+        }
+        else if (strcmp(argv[i], "--tt-bench") == 0)
+        {
+            options.tableBench = true;
+        }
+        else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+        {
+            options.maxDepth = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--movetime") == 0 && i + 1 < argc)
+        {
+            options.moveTime = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--driver") == 0 && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            int driver = 0;
+            while (driver < NUM_ROOT_DRIVERS && strcmp(name, ROOT_DRIVER_NAMES[driver]) != 0)
+            {
+                driver++;
+            }
+            if (driver == NUM_ROOT_DRIVERS)
+            {
+                printf("Unknown root driver %s, use alphabeta, pvs or mtdf.\n", name);
+                return 1;
+            }
+            options.driver = (RootDriver)driver;
+            options.inPlace = true; // The drivers run the make/unmake search
+        }
+        else if (strcmp(argv[i], "--order") == 0 && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            int policy = 0;
+            while (policy < NUM_ORDER_POLICIES && strcmp(name, ORDER_POLICY_NAMES[policy]) != 0)
+            {
+                policy++;
+            }
+            if (policy == NUM_ORDER_POLICIES)
+            {
+                printf("Unknown move ordering %s, use none, tactical, killers or history.\n", name);
+                return 1;
+            }
+            options.order = (OrderPolicy)policy;
+            options.inPlace = true; // The tree search keeps the original move order
+        }
+        else if (strcmp(argv[i], "--race") == 0)
+        {
+            options.race = true;
+        }
+        else if (strcmp(argv[i], "--race-report") == 0)
+        {
+            options.raceReport = true;
+        }
+        else if (strcmp(argv[i], "--mcts") == 0)
+        {
+            options.mcts = true;
+        }
+        else if (strcmp(argv[i], "--playouts") == 0 && i + 1 < argc)
+        {
+            options.mcts = true;
+            options.playouts = (uint64_t)std::max(1LL, atoll(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--match") == 0 && i + 2 < argc)
+        {
+            options.match[0] = argv[++i];
+            options.match[1] = argv[++i];
+        }
+        else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+        {
+            options.matchGames = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--order-report") == 0)
+        {
+            options.orderReport = true;
+        }
+        else if (strcmp(argv[i], "--tablebase") == 0 && i + 1 < argc)
+        {
+            options.tablebaseFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--build-tablebase") == 0 && i + 1 < argc)
+        {
+            options.buildTablebase = argv[++i];
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            options.batch = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            int level = TRACE_OFF;
+            while (level <= TRACE_FULL && strcmp(name, TRACE_LEVEL_NAMES[level]) != 0)
+            {
+                level++;
+            }
+            if (level > TRACE_FULL)
+            {
+                printf("Unknown trace level %s, use off, root or full.\n", name);
+                return 1;
+            }
+            options.traceLevel = (TraceLevel)level;
+        }
+        else if (strcmp(argv[i], "--trace-file") == 0 && i + 1 < argc)
+        {
+            options.traceFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--pns") == 0)
+        {
+            options.proofNumber = true;
+        }
+        else if (strcmp(argv[i], "--no-mirror") == 0)
+        {
+            options.mirror = false;
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+        {
+            options.cacheFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc)
+        {
+            options.cacheMegabytes = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--serve") == 0)
+        {
+            options.serve = true;
+        }
+        else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+        {
+            options.serve = true;
+            options.socketPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--perft") == 0 && i + 1 < argc)
+        {
+            options.perftDepth = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--divide") == 0)
+        {
+            options.divide = true;
+        }
+        else
+        {
+            printf("Usage: %s [--tt MB] [--inplace] [--arena] [--keep-tree] [--memstats] [--threads N] [--speedup] [--tt-bench]\n"
+                   "          [--depth N] [--movetime ms] [--order none|tactical|killers|history] [--order-report]\n"
+                   "          [--driver alphabeta|pvs|mtdf] [--race] [--race-report] [--mcts] [--playouts N]\n"
+                   "          [--match ENGINE ENGINE] [--games N]\n"
+                   "          [--tablebase FILE] [--build-tablebase FILE] [--batch FILE|DIR]\n"
+                   "          [--trace off|root|full] [--trace-file FILE] [--pns] [--no-mirror]\n"
+                   "          [--cache FILE] [--cache-mb MB] [--serve] [--socket PATH] [--perft N] [--divide]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    InitZobristKeys();
+
+    if (options.tableBench)
+    {
+        int maxThreads = DefaultThreads(options);
+        SharedBenchmark(options.ttMegabytes > 0 ? options.ttMegabytes : 64, maxThreads);
+        return 0;
+    }
+
+    if (options.raceReport)
+    {
+        return RaceReport(options);
+    }
+
+    if (options.speedup)
+    {
+        return SpeedupReportFiles(options);
+    }
+
+    if (options.batch != NULL)
+    {
+        return RunBatch(options);
+    }
+
+    if (options.serve)
+    {
+        return RunServer(options);
+    }
+
+    // The board size comes from input.txt, and each supported size has its own engine
+    int rows = DEFAULT_ROWS;
+    int cols = DEFAULT_COLS;
+    ReadBoardSize("input.txt", rows, cols);
+
+#define RUN_SOLVER(r, c) if (rows == r && cols == c) { int result = RunSolver<r, c>(options); STATS(StatsReport(r, c)); return result; }
+    SUPPORTED_BOARDS(RUN_SOLVER)
+#undef RUN_SOLVER
+
+    printf("Unsupported board size %d x %d in input.txt.\n", rows, cols);
+    return 1;
+}
+#endif // SOLVER_LIBRARY
+
+template <int R, int C>
+int RunSolver(const SolverOptions &options)
+{
+    // Create the initial node:
+    Node* startNode = new Node();
+    startNode->position.isWhitePlayer = true;
+    LoadFileCustom<R, C>(startNode, "input.txt");
+    DEBUG(PrintList<R, C>(startNode));
+    //Tests<R, C>(startNode);
+
+    if (options.buildTablebase != NULL)
+    {
+        int threads = DefaultThreads(options);
+        return BuildTablebase<R, C>(options.buildTablebase, threads);
+    }
+
+    if (options.perftDepth > 0)
+    {
+        PerftReport<R, C>(startNode->position, options.perftDepth, options.divide);
+        return 0;
+    }
+
+    if (options.match[0] != NULL)
+    {
+        return RunMatch<R, C>(options);
+    }
+
+    TranspositionTable tt;
+    NodeArena arena;
+    SearchContext context;
+    SearchContextInit(context, SolverSearchOptions(options), NULL, NULL);
+    context.releaseSubtrees = !options.keepTree;
+    context.scout = options.driver == DRIVER_PVS;
+    if (options.driver == DRIVER_MTDF && options.ttMegabytes == 0)
+    {
+        TTInit(tt, MTDF_DEFAULT_MEGABYTES); // Every pass after the first is answered mostly from the table
+        context.tt = &tt;
+    }
+    if (options.ttMegabytes > 0 && !options.proofNumber && options.threads == 0) // Proof-number and parallel search size their own tables with --tt
+    {
+        TTInit(tt, options.ttMegabytes);
+        context.tt = &tt;
+    }
+    if (options.useArena)
+    {
+        ArenaInit(arena, 1 << 20);
+        context.arena = &arena;
+    }
+
+    Tablebase tablebase;
+    if (options.tablebaseFile != NULL)
+    {
+        if (!TablebaseLoad(tablebase, options.tablebaseFile))
+        {
+            printf("Could not load the tablebase %s, searching without it.\n", options.tablebaseFile);
+        }
+        else if (tablebase.rows != R || tablebase.cols != C)
+        {
+            printf("The tablebase %s is for a %d x %d board, searching without it.\n", options.tablebaseFile, tablebase.rows, tablebase.cols);
+            TablebaseUnload(tablebase);
+        }
+        else
+        {
+            context.tablebase = &tablebase;
+        }
+    }
+
+    SolveCache cache;
+    cache.fd = -1;
+    if (options.cacheFile != NULL)
+    {
+        if (CacheOpen(cache, options.cacheFile, R, C, options.cacheMegabytes))
+        {
+            context.cache = &cache;
+        }
+        else
+        {
+            printf("Could not use the solve cache %s (missing, unwritable or for another board size), solving without it.\n", options.cacheFile);
+        }
+    }
+
+    if (options.orderReport)
+    {
+        OrderingReport<R, C>(startNode->position, options);
+        return 0;
+    }
+
+    MoveOrdering *ordering = NULL; // Big enough (killers and history) to want it off the stack
+    if (options.order != ORDER_NONE || options.driver != DRIVER_ALPHABETA) // The drivers are compared by its node count
+    {
+        ordering = OrderingCreate(options.order);
+        context.ordering = ordering;
+    }
+
+    int winInt;
+    Point bestFrom;
+    Point bestTo;
+    std::string proofSummary; // Printed with the results by the proof-number search
+    std::string driverSummary; // Printed with the results by the PVS and MTD(f) drivers
+    std::string tableSummary; // Printed with the results by the parallel search
+    std::string mctsSummary; // Printed with the results by the Monte Carlo search
+    ProofContext *proof = NULL; // Kept until its proofs are written to the cache
+    std::chrono::steady_clock::time_point solveStart = std::chrono::steady_clock::now();
+
+    // A board some earlier run already answered is not searched again.  The answer
+    // is keyed like the table entries, so the mirrored board finds it too, with the
+    // move mirrored back.
+    int cachedValue;
+    int cachedFrom;
+    int cachedTo;
+    uint8_t cachedFlags;
+    bool rootMirrored = false;
+    uint64_t rootKey = TableKey<R, C>(startNode->position, options.mirror, rootMirrored);
+    bool answerCached = context.cache != NULL && Board<R, C>::CheckWinCondition(startNode->position) == 0 &&
+                        CacheProbe(cache, rootKey, cachedValue, cachedFrom, cachedTo, cachedFlags) &&
+                        (cachedFlags & CACHE_ANSWER) != 0;
+    if (answerCached)
+    {
+        winInt = cachedValue;
+        bestFrom = Board<R, C>::SquareToPoint(rootMirrored ? Board<R, C>::MirrorSquare(cachedFrom) : cachedFrom);
+        bestTo = Board<R, C>::SquareToPoint(rootMirrored ? Board<R, C>::MirrorSquare(cachedTo) : cachedTo);
+        printf("Solve Cache: answer read from %s.\n", options.cacheFile);
+    }
+    else if (options.mcts)
+    {
+        Move rootMove;
+        rootMove.from = -1;
+        rootMove.to = -1;
+        uint64_t playouts = 0;
+        winInt = MctsSearch<R, C>(startNode->position, options, &rootMove, playouts, mctsSummary);
+        bestFrom = Board<R, C>::SquareToPoint(rootMove.from);
+        bestTo = Board<R, C>::SquareToPoint(rootMove.to);
+    }
+    else if (options.threads > 0)
+    {
+        ThreadPool pool;
+        PoolInit(pool, options.threads);
+        SharedTable *table = NULL;
+        if (options.ttMegabytes > 0)
+        {
+            table = new SharedTable();
+            SharedInit(*table, options.ttMegabytes, options.threads, options.mirror);
+            SharedNewSearch(*table);
+        }
+        Move rootMove;
+        rootMove.from = -1;
+        rootMove.to = -1;
+        winInt = ParallelRootSearch<R, C>(startNode->position, &pool, table, &rootMove);
+        PoolShutdown(pool);
+        if (table != NULL)
+        {
+            SharedCounters totals = SharedTotals(*table);
+            char summary[256];
+            snprintf(summary, sizeof(summary), "Shared Table: %d MB on %d threads, %llu probes, %llu hits (%.1f%% hit rate), "
+                     "%llu stores, %llu replaced, %llu torn", options.ttMegabytes, options.threads,
+                     (unsigned long long)totals.probes, (unsigned long long)totals.hits,
+                     totals.probes > 0 ? 100.0 * totals.hits / totals.probes : 0.0, (unsigned long long)totals.stores,
+                     (unsigned long long)totals.replaced, (unsigned long long)totals.torn);
+            tableSummary = summary;
+            delete table;
+        }
+        bestFrom = Board<R, C>::SquareToPoint(rootMove.from);
+        bestTo = Board<R, C>::SquareToPoint(rootMove.to);
+    }
+    else if (options.maxDepth > 0 || options.moveTime > 0)
+    {
+        Move rootMove;
+        rootMove.from = -1;
+        rootMove.to = -1;
+        winInt = IterativeDeepening<R, C>(startNode->position, options, context.tt, ordering, &rootMove);
+        bestFrom = Board<R, C>::SquareToPoint(rootMove.from);
+        bestTo = Board<R, C>::SquareToPoint(rootMove.to);
+    }
+    else if (options.proofNumber)
+    {
+        proof = new ProofContext();
+        ProofTableInit(proof->table, options.ttMegabytes > 0 ? options.ttMegabytes : PN_DEFAULT_MEGABYTES);
+        proof->tablebase = context.tablebase;
+        proof->cache = context.cache;
+        proof->mirror = options.mirror;
+        proof->nodes = 0;
+        Move rootMove;
+        rootMove.from = -1;
+        rootMove.to = -1;
+        winInt = ProofNumberRoot<R, C>(startNode->position, proof, &rootMove);
+        uint64_t searchNodes = proof->nodes;
+        std::unordered_set<uint64_t> proofTree;
+        ProofTreeSize<R, C>(startNode->position, proof, proofTree);
+        bestFrom = Board<R, C>::SquareToPoint(rootMove.from);
+        bestTo = Board<R, C>::SquareToPoint(rootMove.to);
+        proofSummary = "Proof-Number Search: " + std::to_string(searchNodes) + " positions expanded, "
+                       + (winInt > 0 ? "proof" : "disproof") + " tree of " + std::to_string(proofTree.size()) + " positions";
+    }
+    else if (options.inPlace)
+    {
+        Move rootMove;
+        rootMove.from = -1;
+        rootMove.to = -1;
+        int passes = 0;
+        winInt = DriverSearch<R, C>(startNode->position, options.driver, &context, &rootMove, passes);
+        bestFrom = Board<R, C>::SquareToPoint(rootMove.from);
+        bestTo = Board<R, C>::SquareToPoint(rootMove.to);
+        if (options.driver != DRIVER_ALPHABETA)
+        {
+            driverSummary = DriverComparison<R, C>(startNode->position, options, context, ordering->nodes, passes);
+        }
+    }
+    else
+    {
+        TraceWriter trace;
+        if (!TraceOpen(trace, options.traceLevel, options.traceFile))
+        {
+            printf("Could not open the trace file %s.\n", options.traceFile);
+            return 1;
+        }
+        context.trace = &trace;
+        winInt = AlphaBetaSearch<R, C>(startNode, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), &context, 0);
+        TraceClose(trace);
+        context.trace = NULL;
+        bestFrom = startNode->whiteWinNode->movedFrom;
+        bestTo = startNode->whiteWinNode->movedTo;
+    }
+    double solveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - solveStart).count();
+
+    std::cout << std::endl << "-----Expansions Complete-----" << std::endl;
+
+    std::cout << std::endl << "----------------RESULTS-----------------"<< std::endl;
+
+    printf("Answer:  Player A moves the piece at (%d, %d) to (%d, %d).\n",
+           bestFrom.r, bestFrom.c, bestTo.r, bestTo.c
+    );
+
+    std::cout << "Alpha Beta Search Result: " << winInt << std::endl;
+
+    if (!proofSummary.empty())
+    {
+        printf("%s\n", proofSummary.c_str());
+    }
+
+    if (!driverSummary.empty())
+    {
+        printf("%s\n", driverSummary.c_str());
+    }
+
+    if (!tableSummary.empty())
+    {
+        printf("%s\n", tableSummary.c_str());
+    }
+
+    if (!mctsSummary.empty())
+    {
+        printf("%s\n", mctsSummary.c_str());
+    }
+
+    if (context.tt != NULL)
+    {
+        printf("Transposition Table: %d MB, %llu probes, %llu hits (%.1f%% hit rate), %llu stores\n",
+               options.ttMegabytes > 0 ? options.ttMegabytes : MTDF_DEFAULT_MEGABYTES, (unsigned long long)tt.probes, (unsigned long long)tt.hits,
+               tt.probes > 0 ? 100.0 * tt.hits / tt.probes : 0.0, (unsigned long long)tt.stores);
+    }
+
+    if (options.memoryStats)
+    {
+        if (options.useArena)
+        {
+            PrintMemoryStats("arena", arena.stats);
+        }
+        else
+        {
+            PrintMemoryStats("new", g_heapStats);
+        }
+    }
+
+    if (context.tablebase != NULL)
+    {
+        int distance = 0;
+        int rootValue = TablebaseProbe<R, C>(tablebase, startNode->position, &distance);
+        printf("Tablebase: %llu probes, %llu hits", (unsigned long long)tablebase.probes, (unsigned long long)tablebase.hits);
+        if (rootValue != 0)
+        {
+            printf(", %s wins in %d plies from here", rootValue > 0 ? "Player A" : "Player B", distance);
+        }
+        printf("\n");
+        TablebaseUnload(tablebase);
+    }
+
+    if (ordering != NULL)
+    {
+        printf("Move Ordering (%s): %llu nodes\n", ORDER_POLICY_NAMES[ordering->policy], (unsigned long long)ordering->nodes);
+        delete ordering;
+    }
+
+    if (context.cache != NULL)
+    {
+        // Everything this run proved goes back into the cache for the next one: the
+        // answer itself, costed by how long it took, then every proven table entry
+        if (!answerCached && (winInt == 1 || winInt == -1) && Board<R, C>::CheckWinCondition(startNode->position) == 0 &&
+            CacheBeginWrite(cache))
+        {
+            int from = Board<R, C>::PointToSquare(bestFrom);
+            int to = Board<R, C>::PointToSquare(bestTo);
+            CacheStore(cache, rootKey, winInt, rootMirrored ? Board<R, C>::MirrorSquare(from) : from,
+                       rootMirrored ? Board<R, C>::MirrorSquare(to) : to, CACHE_ANSWER, (uint64_t)solveMs + 1);
+            if (context.tt != NULL && options.threads == 0)
+            {
+                bool iterative = options.maxDepth > 0 || options.moveTime > 0;
+                CacheStoreTable(cache, tt, iterative ? WIN_SCORE : 1);
+            }
+            if (proof != NULL)
+            {
+                CacheStoreProofTable(cache, proof->table);
+            }
+            CacheEndWrite(cache);
+        }
+        printf("Solve Cache: %llu probes, %llu hits, %llu stored\n", (unsigned long long)cache.probes,
+               (unsigned long long)cache.hits, (unsigned long long)cache.stores);
+        CacheClose(cache);
+    }
+    delete proof;
+
+    if (options.useArena)
+    {
+        ArenaFree(arena);
+    }
+
+    return 0;
+}
+
+template <int R, int C>
+int AlphaBetaSearch(Node *n, int a, int b)
+{
+    return AlphaBetaSearch<R, C>(n, a, b, NULL, 0);
+}
+
+template <int R, int C>
+int SearchChild(Node *child, int a, int b, SearchContext *ctx, int ply, bool release)
+{
+    if (!release)
+    {
+        return AlphaBetaSearch<R, C>(child, a, b, ctx, ply);
+    }
+
+    // Everything the child allocates lives above the mark, so once its value
+    // is known the whole subtree goes back to the arena in one step
+    ArenaMark mark = ArenaGetMark(*ctx->arena);
+    int value = AlphaBetaSearch<R, C>(child, a, b, ctx, ply);
+    ArenaRelease(*ctx->arena, mark);
+    child->children.clear();
+    child->whiteWinNode = NULL;
+    return value;
+}
+
+template <int R, int C>
+int AlphaBetaSearch(Node *n, int a, int b, SearchContext *ctx, int ply)
+{
+    // Check the win conditions
+    int winInt = Board<R, C>::CheckWinCondition(n->position);
+    STATS(StatsNode(ply, winInt != 0));
+    if (winInt != 0)
+    {
+        DEBUG(TracePrint(ctx != NULL ? ctx->trace : NULL, "Win value found, returning %d.\n", winInt));
+        return winInt;
+    }
+    else if (ctx != NULL && ctx->race && ply > 0 && (winInt = Board<R, C>::RaceWinner(n->position)) != 0)
+    {
+        return winInt; // Decided already, no need to expand it
+    }
+    else
+    {
+        // Look the position up before expanding it.  The root is never cut off
+        // here since it still has to pick whiteWinNode out of its own children.
+        TranspositionTable *tt = (ctx != NULL) ? ctx->tt : NULL;
+        uint64_t key = 0;
+        TTEntry entry = TTEntry();
+        bool found = false;
+        bool mirrored = false;
+        int alphaOrig = a;
+        int betaOrig = b;
+        if (tt != NULL)
+        {
+            key = TableKey<R, C>(n->position, ctx->mirror, mirrored);
+            found = TTProbe(*tt, key, entry);
+            if (found && ply > 0 && TTCutoff(entry, a, b))
+            {
+                return entry.value;
+            }
+        }
+
+        // The tablebase knows the answer outright, again everywhere but the root
+        if (ctx != NULL && ctx->tablebase != NULL && ply > 0)
+        {
+            int tablebaseValue = TablebaseProbe<R, C>(*ctx->tablebase, n->position, NULL);
+            if (tablebaseValue != 0)
+            {
+                return tablebaseValue;
+            }
+        }
+
+        // So does the cache, for positions an earlier run solved
+        if (ctx != NULL && ctx->cache != NULL && ply > 0)
+        {
+            int cachedValue;
+            int cachedFrom;
+            int cachedTo;
+            uint8_t cachedFlags;
+            if (tt == NULL)
+            {
+                key = TableKey<R, C>(n->position, ctx->mirror, mirrored);
+            }
+            if (CacheProbe(*ctx->cache, key, cachedValue, cachedFrom, cachedTo, cachedFlags))
+            {
+                return cachedValue;
+            }
+        }
+
+        // Create the children first
+        // Find and Move Pieces finds all of the pieces
+        // of the current player, and then creates children
+        // from all of them.  Then, for each of those children
+        // we recurse through a-B pruning until a <= B
+        NodeArena *arena = (ctx != NULL) ? ctx->arena : NULL;
+        bool release = arena != NULL && ctx->releaseSubtrees;
+        FindAndMovePieces<R, C>(n, arena);
+        STATS(StatsChildren(ply, n->children.size()));
+
+        // The stored best move is the most likely one to cause a cutoff again
+        if (found && ply > 0 && entry.bestFrom >= 0)
+        {
+            MoveChildToFront<R, C>(n, mirrored ? Board<R, C>::MirrorSquare(entry.bestFrom) : entry.bestFrom,
+                                   mirrored ? Board<R, C>::MirrorSquare(entry.bestTo) : entry.bestTo);
+        }
+
+        int bestChild = -1;
+
+        // Only the trace level decides what gets printed, the search itself is the same
+        TraceWriter *trace = (ctx != NULL) ? ctx->trace : NULL;
+        bool tracing = TraceEnabled(trace, ply);
+
+        // Loop through all children and expand through tree
+        for (unsigned int i = 0; i < n->children.size(); i++) // For each child
+        {
+            if (n->position.isWhitePlayer) // Maximizing Player
+            {
+                if (b > a)
+                {
+                    if (tracing) TracePrint(trace, "Player A moves the piece at (%d,%d) to (%d,%d).\n", n->children[i]->movedFrom.r, n->children[i]->movedFrom.c, n->children[i]->movedTo.r, n->children[i]->movedTo.c);
+                    DEBUG(PrintList<R, C>(n->children[i], trace));
+                    int childValue = SearchChild<R, C>(n->children[i], a, b, ctx, ply + 1, release);
+                    if (childValue > a || bestChild < 0)
+                    {
+                        bestChild = i;
+                    }
+                    a = std::max(a, childValue);
+                    STATS(if (b <= a) StatsCutoff(ply, i));
+
+                    if ((a == 1 || i == n->children.size() - 1) && n->whiteWinNode == NULL)
+                    {
+                        // Get first reference to winning move or just the last move if there is no good one
+                        // This is done specifically for White Player, or P1, to satisfy the first move problem
+                        // as outlined in the assignment 3 document
+                        n->whiteWinNode = n->children[i];
+                    }
+
+                    if (b <= a && i != n->children.size() - 1) // Start off the print sequence if true
+                    {
+                        if (tracing) TracePrint(trace, "Skipping Player A's moves: ");
+                    }
+                }
+                else
+                {
+                    if (!tracing)
+                    {
+                        break; // The rest of the loop only prints the skipped moves
+                    }
+                    TracePrint(trace, "(%d,%d) to (%d,%d)", n->children[i]->movedFrom.r, n->children[i]->movedFrom.c, n->children[i]->movedTo.r, n->children[i]->movedTo.c);
+                    if (i == n->children.size() - 1)
+                    {
+                        TracePrint(trace, "; Alpha = %d, Beta = %d.\n", a, b);
+                    }
+                    else
+                    {
+                        TracePrint(trace, ", ");
+                    }
+                }
+            }
+            else // Minimizing Player
+            {
+                if (b > a)
+                {
+                    if (tracing) TracePrint(trace, "Player B moves the piece at (%d,%d) to (%d,%d).\n", n->children[i]->movedFrom.r, n->children[i]->movedFrom.c, n->children[i]->movedTo.r, n->children[i]->movedTo.c);
+                    DEBUG(PrintList<R, C>(n->children[i], trace));
+                    int childValue = SearchChild<R, C>(n->children[i], a, b, ctx, ply + 1, release);
+                    if (childValue < b || bestChild < 0)
+                    {
+                        bestChild = i;
+                    }
+                    b = std::min(b, childValue);
+                    STATS(if (b <= a) StatsCutoff(ply, i));
+
+                    if ((b == 1 || i == n->children.size() - 1) && n->whiteWinNode == NULL)
+                    {
+                        // Get first reference to winning move or just the last move if there is no good one
+                        // This is done specifically for White Player, or P1, to satisfy the first move problem
+                        // as outlined in the assignment 3 document
+                        n->whiteWinNode = n->children[i];
+                    }
+
+                    if (b <= a && i != n->children.size() - 1) // Start off the print sequence if true
+                    {
+                        if (tracing) TracePrint(trace, "Skipping Player B's moves: ");
+                    }
+                }
+                else// Start off the print sequence if true
+                {
+                    if (!tracing)
+                    {
+                        break; // The rest of the loop only prints the skipped moves
+                    }
+                    TracePrint(trace, "(%d,%d) to (%d,%d)", n->children[i]->movedFrom.r, n->children[i]->movedFrom.c, n->children[i]->movedTo.r, n->children[i]->movedTo.c);
+                    if (i == n->children.size() - 1)
+                    {
+                        TracePrint(trace, "; Alpha = %d, Beta = %d.\n", a, b);
+                    }
+                    else
+                    {
+                        TracePrint(trace, ", ");
+                    }
+                }
+            }
+
+            //printf("Alpha: %d, Beta: %d\n", a, b);
+        }
+
+        int value = n->position.isWhitePlayer ? a : b;
+
+        if (tt != NULL)
+        {
+            TTFlag flag = BoundFlag(value, alphaOrig, betaOrig);
+            if (bestChild >= 0)
+            {
+                // Stored the way round the canonical form is, the probe flips it back
+                Node *best = n->children[bestChild];
+                int from = Board<R, C>::PointToSquare(best->movedFrom);
+                int to = Board<R, C>::PointToSquare(best->movedTo);
+                TTStore(*tt, key, value, TT_DEPTH_SOLVED, flag, mirrored ? Board<R, C>::MirrorSquare(from) : from,
+                        mirrored ? Board<R, C>::MirrorSquare(to) : to);
+            }
+            else
+            {
+                TTStore(*tt, key, value, TT_DEPTH_SOLVED, flag, -1, -1);
+            }
+        }
+
+        // Return the appropriate value
+        return value;
+    }
+}
+
+template <int R, int C>
+int InPlaceSearch(Position &p, int a, int b, SearchContext *ctx, int ply, Move *rootMove)
+{
+    // The same search as AlphaBetaSearch, move for move, but every child is made
+    // and taken back on the one Position instead of being built as a Node.  Only
+    // the root gets a rootMove, picked the same way as whiteWinNode (for Black to
+    // move, the first move that wins for Black).
+    MoveOrdering *ordering = (ctx != NULL) ? ctx->ordering : NULL;
+    if (ordering != NULL)
+    {
+        ordering->nodes++;
+    }
+
+    int winInt = Board<R, C>::CheckWinCondition(p);
+    STATS(StatsNode(ply, winInt != 0));
+    if (winInt != 0)
+    {
+        return winInt;
+    }
+
+    if (ctx != NULL && ctx->race && ply > 0)
+    {
+        int raceValue = Board<R, C>::RaceWinner(p);
+        if (raceValue != 0)
+        {
+            return raceValue;
+        }
+    }
+
+    TranspositionTable *tt = (ctx != NULL) ? ctx->tt : NULL;
+    uint64_t key = 0;
+    TTEntry entry = TTEntry();
+    bool found = false;
+    bool mirrored = false;
+    int alphaOrig = a;
+    int betaOrig = b;
+    if (tt != NULL)
+    {
+        key = TableKey<R, C>(p, ctx->mirror, mirrored);
+        found = TTProbe(*tt, key, entry);
+        if (found && ply > 0 && TTCutoff(entry, a, b))
+        {
+            return entry.value;
+        }
+    }
+
+    if (ctx != NULL && ctx->tablebase != NULL && ply > 0)
+    {
+        int tablebaseValue = TablebaseProbe<R, C>(*ctx->tablebase, p, NULL);
+        if (tablebaseValue != 0)
+        {
+            return tablebaseValue;
+        }
+    }
+
+    if (ctx != NULL && ctx->cache != NULL && ply > 0)
+    {
+        int cachedValue;
+        int cachedFrom;
+        int cachedTo;
+        uint8_t cachedFlags;
+        if (tt == NULL)
+        {
+            key = TableKey<R, C>(p, ctx->mirror, mirrored);
+        }
+        if (CacheProbe(*ctx->cache, key, cachedValue, cachedFrom, cachedTo, cachedFlags))
+        {
+            return cachedValue;
+        }
+    }
+
+    Move moves[Board<R, C>::MAX_MOVES];
+    int numMoves = Board<R, C>::GenerateMoves(p, moves);
+    STATS(StatsChildren(ply, numMoves));
+
+    if (ordering != NULL)
+    {
+        OrderMoves<R, C>(p, moves, numMoves, ply, ordering);
+    }
+    if (found && ply > 0 && entry.bestFrom >= 0)
+    {
+        MoveToFront(moves, numMoves, mirrored ? Board<R, C>::MirrorSquare(entry.bestFrom) : entry.bestFrom,
+                    mirrored ? Board<R, C>::MirrorSquare(entry.bestTo) : entry.bestTo);
+    }
+
+    bool isWhitePlayer = p.isWhitePlayer;
+    int bestMove = -1;
+    bool rootMoveSet = false;
+    for (int i = 0; i < numMoves && b > a; i++)
+    {
+        Undo undo;
+        MakeMove(p, moves[i], undo);
+        int childValue;
+        if (ctx != NULL && ctx->scout && i > 0)
+        {
+            // Only a child that beats the best so far needs its real value
+            childValue = isWhitePlayer ? InPlaceSearch<R, C>(p, a, a + 1, ctx, ply + 1, NULL)
+                                       : InPlaceSearch<R, C>(p, b - 1, b, ctx, ply + 1, NULL);
+            if (childValue > a && childValue < b)
+            {
+                childValue = InPlaceSearch<R, C>(p, a, b, ctx, ply + 1, NULL);
+            }
+        }
+        else
+        {
+            childValue = InPlaceSearch<R, C>(p, a, b, ctx, ply + 1, NULL);
+        }
+        UnmakeMove(p, moves[i], undo);
+
+        if (isWhitePlayer) // Maximizing Player
+        {
+            if (childValue > a || bestMove < 0)
+            {
+                bestMove = i;
+            }
+            a = std::max(a, childValue);
+        }
+        else // Minimizing Player
+        {
+            if (childValue < b || bestMove < 0)
+            {
+                bestMove = i;
+            }
+            b = std::min(b, childValue);
+        }
+
+        if (rootMove != NULL && !rootMoveSet && ((isWhitePlayer ? a == 1 : b == -1) || i == numMoves - 1))
+        {
+            *rootMove = moves[i];
+            rootMoveSet = true;
+        }
+
+        STATS(if (b <= a) StatsCutoff(ply, i));
+        if (b <= a && ordering != NULL)
+        {
+            RecordCutoff(ordering, p, moves[i], ply, 1);
+        }
+    }
+
+    int value = isWhitePlayer ? a : b;
+
+    if (tt != NULL)
+    {
+        TTFlag flag = BoundFlag(value, alphaOrig, betaOrig);
+        if (bestMove >= 0)
+        {
+            Move best = moves[bestMove];
+            TTStore(*tt, key, value, TT_DEPTH_SOLVED, flag, mirrored ? Board<R, C>::MirrorSquare(best.from) : best.from,
+                    mirrored ? Board<R, C>::MirrorSquare(best.to) : best.to);
+        }
+        else
+        {
+            TTStore(*tt, key, value, TT_DEPTH_SOLVED, flag, -1, -1);
+        }
+    }
+
+    return value;
+}
+
+template <int R, int C>
+int MtdfSearch(Position &p, int guess, SearchContext *ctx, Move *rootMove, int &passes)
+{
+    // MTD(f) narrows [lower, upper] with null window searches around its guess.
+    // Every game ends in -1 or 1 and nothing lies between them, so a fail low
+    // proves -1 and a fail high proves 1, and the bounds meet after one pass.  The
+    // root move comes out of the pass the same way the full window search picks it.
+    int lower = -1;
+    int upper = 1;
+    int g = guess;
+    while (lower < upper)
+    {
+        int beta = (g == lower) ? g + 1 : g;
+        g = InPlaceSearch<R, C>(p, beta - 1, beta, ctx, 0, rootMove);
+        passes++;
+        if (g < beta)
+        {
+            upper = g = -1;
+        }
+        else
+        {
+            lower = g = 1;
+        }
+    }
+    return g;
+}
+
+template <int R, int C>
+int DriverSearch(Position &p, RootDriver driver, SearchContext *ctx, Move *rootMove, int &passes)
+{
+    passes = 1;
+    if (driver == DRIVER_MTDF)
+    {
+        passes = 0;
+        return MtdfSearch<R, C>(p, 1, ctx, rootMove, passes);
+    }
+    return InPlaceSearch<R, C>(p, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), ctx, 0, rootMove);
+}
+
+template <int R, int C>
+std::string DriverComparison(const Position &start, const SolverOptions &options, const SearchContext &driverContext,
+                             uint64_t nodes, int passes)
+{
+    // The same search from scratch (fresh table and ordering, same sizes and
+    // tablebase) with one full window, for the node count to hold the driver against
+    Position p = start;
+    SearchContext context = driverContext;
+    context.scout = false;
+    context.cache = NULL; // Would now answer everything the driver just stored
+    TranspositionTable tt;
+    if (driverContext.tt != NULL)
+    {
+        TTInit(tt, options.ttMegabytes > 0 ? options.ttMegabytes : MTDF_DEFAULT_MEGABYTES);
+        context.tt = &tt;
+    }
+    MoveOrdering *ordering = OrderingCreate(options.order);
+    context.ordering = ordering;
+    Move rootMove;
+    rootMove.from = -1;
+    rootMove.to = -1;
+    int value = InPlaceSearch<R, C>(p, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), &context, 0, &rootMove);
+    uint64_t plainNodes = ordering->nodes;
+    delete ordering;
+
+    char summary[256];
+    snprintf(summary, sizeof(summary), "Root Driver (%s): %llu nodes in %d pass%s, alpha-beta: %llu nodes (result %d), %.1f%% of its nodes",
+             ROOT_DRIVER_NAMES[options.driver], (unsigned long long)nodes, passes, passes == 1 ? "" : "es",
+             (unsigned long long)plainNodes, value, plainNodes > 0 ? 100.0 * nodes / plainNodes : 0.0);
+    return summary;
+}
+
+template <int R, int C>
+int IterativeDeepening(Position &p, const SolverOptions &options, TranspositionTable *tt, MoveOrdering *ordering, Move *rootMove)
+{
+    // Search to depth 1, 2, 3, ... keeping the best move of the last iteration that
+    // finished.  Stops once the result is proven (a win was found, or nothing was cut
+    // off at the horizon), at --depth, or when the --movetime budget runs out.
+    IterativeContext *ctx = new IterativeContext();
+    ctx->tt = tt;
+    ctx->ordering = ordering;
+    ctx->mirror = options.mirror;
+    ctx->hasDeadline = options.moveTime > 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ctx->deadline = start + std::chrono::milliseconds(options.moveTime);
+    ctx->aborted = false;
+    ctx->nodes = 0;
+    ctx->previousPvLength = 0;
+
+    // Hold a move even if the first iteration runs out of time
+    Move moves[Board<R, C>::MAX_MOVES];
+    if (Board<R, C>::CheckWinCondition(p) == 0 && Board<R, C>::GenerateMoves(p, moves) > 0)
+    {
+        *rootMove = moves[0];
+    }
+
+    int maxDepth = options.maxDepth > 0 ? std::min(options.maxDepth, MAX_PLY - 1) : MAX_PLY - 1;
+    int bestScore = 0;
+    bool proven = false;
+
+    for (int depth = 1; depth <= maxDepth; depth++)
+    {
+        ctx->hitHorizon = false;
+        ctx->followPv = true;
+        int score = DepthLimitedSearch<R, C>(p, -WIN_SCORE - 1, WIN_SCORE + 1, depth, 0, ctx);
+        if (ctx->aborted || ctx->pvLength[0] == 0)
+        {
+            break; // Keep the move from the last iteration that finished
+        }
+
+        bestScore = score;
+        *rootMove = ctx->pv[0][0];
+        ctx->previousPvLength = ctx->pvLength[0];
+        for (int i = 0; i < ctx->pvLength[0]; i++)
+        {
+            ctx->previousPv[i] = ctx->pv[0][i];
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        Point from = Board<R, C>::SquareToPoint(rootMove->from);
+        Point to = Board<R, C>::SquareToPoint(rootMove->to);
+        if (!options.quiet)
+        {
+            printf("Depth %d: (%d, %d) to (%d, %d), score %d, %llu nodes, %.1f ms\n",
+                   depth, from.r, from.c, to.r, to.c, score, (unsigned long long)ctx->nodes, ms);
+        }
+
+        proven = score >= WIN_SCORE || score <= -WIN_SCORE || !ctx->hitHorizon;
+        if (proven)
+        {
+            break;
+        }
+
+        // The next iteration takes several times as long as this one, don't start it without the time
+        if (ctx->hasDeadline && ms * 2 > options.moveTime)
+        {
+            break;
+        }
+    }
+
+    if (ordering != NULL)
+    {
+        ordering->nodes += ctx->nodes;
+    }
+    delete ctx;
+
+    if (!proven)
+    {
+        if (!options.quiet)
+        {
+            printf("No proof within the depth/time limit, best guess score %d.\n", bestScore);
+        }
+        return 0;
+    }
+    return bestScore > 0 ? 1 : -1;
+}
+
+template <int R, int C>
+int DepthLimitedSearch(Position &p, int a, int b, int depth, int ply, IterativeContext *ctx)
+{
+    ctx->nodes++;
+    if (ctx->hasDeadline && (ctx->nodes & 1023) == 0 && std::chrono::steady_clock::now() >= ctx->deadline)
+    {
+        ctx->aborted = true;
+    }
+    if (ctx->aborted)
+    {
+        return 0; // Nobody will look at this value
+    }
+
+    ctx->pvLength[ply] = ply;
+
+    int winInt = Board<R, C>::CheckWinCondition(p);
+    STATS(StatsNode(ply, winInt != 0));
+    if (winInt != 0)
+    {
+        return winInt * WIN_SCORE;
+    }
+
+    if (depth == 0 || ply >= MAX_PLY - 1)
+    {
+        ctx->hitHorizon = true;
+        return Board<R, C>::Evaluate(p);
+    }
+
+    TranspositionTable *tt = ctx->tt;
+    uint64_t key = 0;
+    TTEntry entry = TTEntry();
+    bool found = false;
+    bool mirrored = false;
+    int alphaOrig = a;
+    int betaOrig = b;
+    if (tt != NULL)
+    {
+        key = TableKey<R, C>(p, ctx->mirror, mirrored);
+        found = TTProbe(*tt, key, entry);
+        bool deepEnough = found && (entry.depth >= depth || entry.value >= WIN_SCORE || entry.value <= -WIN_SCORE);
+        if (deepEnough && ply > 0 && TTCutoff(entry, a, b))
+        {
+            // A score short of a win was made by Evaluate at some earlier horizon, so
+            // it can't prove anything however deep it was searched
+            if (entry.value < WIN_SCORE && entry.value > -WIN_SCORE)
+            {
+                ctx->hitHorizon = true;
+            }
+            return entry.value;
+        }
+    }
+
+    Move moves[Board<R, C>::MAX_MOVES];
+    int numMoves = Board<R, C>::GenerateMoves(p, moves);
+    STATS(StatsChildren(ply, numMoves));
+    bool isWhitePlayer = p.isWhitePlayer;
+    if (numMoves == 0)
+    {
+        return isWhitePlayer ? -WIN_SCORE : WIN_SCORE; // Nothing to move counts as a loss
+    }
+
+    // Last iteration's best moves go first: the table move, and ahead of it the PV move
+    if (ctx->ordering != NULL)
+    {
+        OrderMoves<R, C>(p, moves, numMoves, ply, ctx->ordering);
+    }
+    if (found && entry.bestFrom >= 0)
+    {
+        MoveToFront(moves, numMoves, mirrored ? Board<R, C>::MirrorSquare(entry.bestFrom) : entry.bestFrom,
+                    mirrored ? Board<R, C>::MirrorSquare(entry.bestTo) : entry.bestTo);
+    }
+    if (ctx->followPv && ply < ctx->previousPvLength)
+    {
+        MoveToFront(moves, numMoves, ctx->previousPv[ply].from, ctx->previousPv[ply].to);
+    }
+    else
+    {
+        ctx->followPv = false;
+    }
+
+    int bestMove = -1;
+    for (int i = 0; i < numMoves && b > a; i++)
+    {
+        if (i > 0)
+        {
+            ctx->followPv = false;
+        }
+
+        Undo undo;
+        MakeMove(p, moves[i], undo);
+        int childValue = DepthLimitedSearch<R, C>(p, a, b, depth - 1, ply + 1, ctx);
+        UnmakeMove(p, moves[i], undo);
+
+        if (ctx->aborted)
+        {
+            return 0;
+        }
+
+        bool improved = isWhitePlayer ? (childValue > a) : (childValue < b);
+        if (improved)
+        {
+            if (isWhitePlayer)
+            {
+                a = childValue;
+            }
+            else
+            {
+                b = childValue;
+            }
+            bestMove = i;
+
+            ctx->pv[ply][ply] = moves[i];
+            for (int j = ply + 1; j < ctx->pvLength[ply + 1]; j++)
+            {
+                ctx->pv[ply][j] = ctx->pv[ply + 1][j];
+            }
+            ctx->pvLength[ply] = std::max(ply + 1, ctx->pvLength[ply + 1]);
+        }
+
+        STATS(if (b <= a) StatsCutoff(ply, i));
+        if (b <= a && ctx->ordering != NULL)
+        {
+            RecordCutoff(ctx->ordering, p, moves[i], ply, depth * depth);
+        }
+    }
+
+    int value = isWhitePlayer ? a : b;
+
+    if (tt != NULL)
+    {
+        TTFlag flag = BoundFlag(value, alphaOrig, betaOrig);
+        if (bestMove >= 0)
+        {
+            Move best = moves[bestMove];
+            TTStore(*tt, key, value, depth, flag, mirrored ? Board<R, C>::MirrorSquare(best.from) : best.from,
+                    mirrored ? Board<R, C>::MirrorSquare(best.to) : best.to);
+        }
+        else
+        {
+            TTStore(*tt, key, value, depth, flag, -1, -1);
+        }
+    }
+
+    return value;
+}
+
+template <int R, int C>
+int ParallelRootSearch(Position &p, ThreadPool *pool, SharedTable *table, Move *rootMove)
+{
+    // The eldest child is searched first, then the rest are handed to the pool
+    // as one task each.  A child that wins cancels every child after it, but the
+    // ones before it carry on, so rootMove is the first winning move in the same
+    // order as whiteWinNode and InPlaceSearch.
+    int a = std::numeric_limits<int>::min();
+    int b = std::numeric_limits<int>::max();
+
+    int winInt = Board<R, C>::CheckWinCondition(p);
+    if (winInt != 0)
+    {
+        return winInt;
+    }
+
+    Move moves[Board<R, C>::MAX_MOVES];
+    int numMoves = Board<R, C>::GenerateMoves(p, moves);
+    if (numMoves == 0)
+    {
+        return p.isWhitePlayer ? a : b;
+    }
+
+    bool isWhitePlayer = p.isWhitePlayer;
+    int winValue = isWhitePlayer ? 1 : -1;
+
+    CancelScope scopes[Board<R, C>::MAX_MOVES];
+    int results[Board<R, C>::MAX_MOVES];
+
+    Undo undo;
+    MakeMove(p, moves[0], undo);
+    results[0] = ParallelSearch<R, C>(p, a, b, 1, &scopes[0], pool, table);
+    UnmakeMove(p, moves[0], undo);
+
+    if (isWhitePlayer)
+    {
+        a = std::max(a, results[0]);
+    }
+    else
+    {
+        b = std::min(b, results[0]);
+    }
+
+    if (results[0] == winValue || numMoves == 1)
+    {
+        *rootMove = moves[0];
+        return isWhitePlayer ? a : b;
+    }
+
+    std::atomic<int> remaining(numMoves - 1);
+    for (int i = 1; i < numMoves; i++)
+    {
+        Position *root = &p;
+        Move move = moves[i];
+        CancelScope *scope = &scopes[i];
+        int *result = &results[i];
+        int childA = a;
+        int childB = b;
+        PoolSubmit(*pool, [=, &remaining, &scopes]()
+        {
+            if (!scope->cancelled)
+            {
+                Position child = ApplyMove(*root, move);
+                *result = ParallelSearch<R, C>(child, childA, childB, 1, scope, pool, table);
+                if (!scope->cancelled && *result == winValue)
+                {
+                    for (int j = (int)(scope - scopes) + 1; j < numMoves; j++)
+                    {
+                        scopes[j].cancelled = true;
+                    }
+                }
+            }
+            remaining--;
+        });
+    }
+
+    while (remaining > 0)
+    {
+        if (!PoolRunPending(*pool))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // First winning child wins, otherwise the last child like the serial search
+    int best = numMoves - 1;
+    for (int i = 1; i < numMoves; i++)
+    {
+        if (!scopes[i].cancelled && results[i] == winValue)
+        {
+            best = i;
+            break;
+        }
+    }
+    for (int i = 1; i < numMoves; i++)
+    {
+        if (scopes[i].cancelled)
+        {
+            continue;
+        }
+        if (isWhitePlayer)
+        {
+            a = std::max(a, results[i]);
+        }
+        else
+        {
+            b = std::min(b, results[i]);
+        }
+    }
+
+    *rootMove = moves[best];
+    return isWhitePlayer ? a : b;
+}
+
+template <int R, int C>
+int ParallelSearch(Position &p, int a, int b, int ply, const CancelScope *scope, ThreadPool *pool, SharedTable *table)
+{
+    // Young Brothers Wait: the first child is always searched alone to set the
+    // window, and only then are its younger brothers shared out with the pool
+    if (IsCancelled(scope))
+    {
+        return 0; // Nobody will look at this value
+    }
+
+    int winInt = Board<R, C>::CheckWinCondition(p);
+    if (winInt != 0)
+    {
+        return winInt;
+    }
+
+    // The search always goes to the end of the game, so the ply stands in for the
+    // depth: a position nearer the root has more of the tree below it
+    uint64_t key = 0;
+    TTEntry entry;
+    bool found = false;
+    bool mirrored = false;
+    int alphaOrig = a;
+    int betaOrig = b;
+    if (table != NULL)
+    {
+        key = TableKey<R, C>(p, table->mirror, mirrored);
+        found = SharedProbe(*table, key, entry);
+        if (found && TTCutoff(entry, a, b))
+        {
+            return entry.value;
+        }
+    }
+
+    Move moves[Board<R, C>::MAX_MOVES];
+    int numMoves = Board<R, C>::GenerateMoves(p, moves);
+    bool isWhitePlayer = p.isWhitePlayer;
+    if (found && entry.bestFrom >= 0)
+    {
+        MoveToFront(moves, numMoves, mirrored ? Board<R, C>::MirrorSquare(entry.bestFrom) : entry.bestFrom,
+                    mirrored ? Board<R, C>::MirrorSquare(entry.bestTo) : entry.bestTo);
+    }
+
+    int value = 0;
+    int bestMove = -1;
+    bool split = false;
+    for (int i = 0; i < numMoves && b > a; i++)
+    {
+        if (i > 0 && ply < MAX_SPLIT_PLY && numMoves - i >= 2 && pool->numThreads > 1)
+        {
+            value = SplitSearch<R, C>(p, moves, i, numMoves, a, b, ply, scope, pool, table);
+            split = true;
+            break;
+        }
+
+        Undo undo;
+        MakeMove(p, moves[i], undo);
+        int childValue = ParallelSearch<R, C>(p, a, b, ply + 1, scope, pool, table);
+        UnmakeMove(p, moves[i], undo);
+
+        if (IsCancelled(scope))
+        {
+            return 0;
+        }
+
+        if (isWhitePlayer) // Maximizing Player
+        {
+            if (childValue > a || bestMove < 0)
+            {
+                bestMove = i;
+            }
+            a = std::max(a, childValue);
+        }
+        else // Minimizing Player
+        {
+            if (childValue < b || bestMove < 0)
+            {
+                bestMove = i;
+            }
+            b = std::min(b, childValue);
+        }
+    }
+    if (!split)
+    {
+        value = isWhitePlayer ? a : b;
+    }
+    else
+    {
+        bestMove = -1; // The helpers don't say which sibling set the value
+    }
+
+    // A cancelled search has only part of the answer, and the window ends are not
+    // values the entry can hold
+    if (table != NULL && !IsCancelled(scope) && value > std::numeric_limits<int16_t>::min() &&
+        value < std::numeric_limits<int16_t>::max())
+    {
+        int bestFrom = bestMove < 0 ? -1 : moves[bestMove].from;
+        int bestTo = bestMove < 0 ? -1 : moves[bestMove].to;
+        if (mirrored && bestMove >= 0)
+        {
+            bestFrom = Board<R, C>::MirrorSquare(bestFrom);
+            bestTo = Board<R, C>::MirrorSquare(bestTo);
+        }
+        SharedStore(*table, key, value, MAX_PLY - ply, BoundFlag(value, alphaOrig, betaOrig), bestFrom, bestTo);
+    }
+    return value;
+}
+
+template <int R, int C>
+int SplitSearch(const Position &p, const Move *moves, int first, int numMoves, int a, int b, int ply, const CancelScope *scope, ThreadPool *pool, SharedTable *table)
+{
+    SplitPoint sp;
+    sp.scope.parent = scope;
+    sp.position = p;
+    for (int i = 0; i < numMoves; i++)
+    {
+        sp.moves[i] = moves[i];
+    }
+    sp.numMoves = numMoves;
+    sp.nextMove = first;
+    sp.a = a;
+    sp.b = b;
+    sp.ply = ply;
+    sp.table = table;
+    sp.activeHelpers = 0;
+
+    // Idle threads pick these up and join in; the owner works here too
+    int helpers = std::min(pool->numThreads - 1, numMoves - first - 1);
+    for (int i = 0; i < helpers; i++)
+    {
+        sp.activeHelpers++;
+        SplitPoint *split = &sp;
+        PoolSubmit(*pool, [split, pool]()
+        {
+            WorkOnSplitPoint<R, C>(split, pool);
+            split->activeHelpers--;
+        });
+    }
+
+    WorkOnSplitPoint<R, C>(&sp, pool);
+
+    // Run other queued work (possibly our own helpers) until every helper is done with sp
+    while (sp.activeHelpers > 0)
+    {
+        if (!PoolRunPending(*pool))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    return p.isWhitePlayer ? sp.a : sp.b;
+}
+
+template <int R, int C>
+void WorkOnSplitPoint(SplitPoint *sp, ThreadPool *pool)
+{
+    Position p = sp->position;
+    bool isWhitePlayer = p.isWhitePlayer;
+
+    while (true)
+    {
+        int i;
+        int a;
+        int b;
+        {
+            std::lock_guard<std::mutex> guard(sp->lock);
+            if (sp->scope.cancelled || sp->nextMove >= sp->numMoves || sp->b <= sp->a)
+            {
+                return;
+            }
+            i = sp->nextMove++;
+            a = sp->a;
+            b = sp->b;
+        }
+
+        Undo undo;
+        MakeMove(p, sp->moves[i], undo);
+        int childValue = ParallelSearch<R, C>(p, a, b, sp->ply + 1, &sp->scope, pool, sp->table);
+        UnmakeMove(p, sp->moves[i], undo);
+
+        if (IsCancelled(&sp->scope))
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(sp->lock);
+        if (isWhitePlayer)
+        {
+            sp->a = std::max(sp->a, childValue);
+        }
+        else
+        {
+            sp->b = std::min(sp->b, childValue);
+        }
+        if (sp->b <= sp->a)
+        {
+            sp->scope.cancelled = true; // Cutoff, stop the siblings still being searched
+        }
+    }
+}
+
+template <int R, int C>
+uint64_t TablebaseSize()
+{
+    // Rows 1 to R - 2 can hold anything, three ways per square.  A position that is
+    // not over yet has no White piece on the top row and no Black piece on the
+    // bottom row, so those two rows only take one bit per square.  Doubled for the
+    // side to move.
+    if (R < 3)
+    {
+        return 0;
+    }
+    uint64_t size = (uint64_t)2 << (2 * C);
+    for (int i = 0; i < (R - 2) * C; i++)
+    {
+        size *= 3;
+        if (size > TB_MAX_POSITIONS)
+        {
+            return 0;
+        }
+    }
+    return size;
+}
+
+template <int R, int C>
+uint64_t TablebaseIndex(const Position &p)
+{
+    const Bitboard rowMask = ((Bitboard)1 << C) - 1;
+    uint64_t index = ((p.black & rowMask) << C) | ((p.white >> ((R - 1) * C)) & rowMask);
+    for (int r = 1; r < R - 1; r++)
+    {
+        Bitboard white = (p.white >> (r * C)) & rowMask;
+        Bitboard black = (p.black >> (r * C)) & rowMask;
+        for (int c = C - 1; c >= 0; c--)
+        {
+            index = index * 3 + ((white >> c) & 1) + 2 * ((black >> c) & 1);
+        }
+    }
+    return p.isWhitePlayer ? index : index + TablebaseSize<R, C>() / 2;
+}
+
+template <int R, int C>
+Position TablebasePosition(uint64_t index)
+{
+    const Bitboard rowMask = ((Bitboard)1 << C) - 1;
+    Position p;
+    p.white = 0;
+    p.black = 0;
+    p.key = 0;
+    p.isWhitePlayer = index < TablebaseSize<R, C>() / 2;
+    if (!p.isWhitePlayer)
+    {
+        index -= TablebaseSize<R, C>() / 2;
+    }
+
+    for (int r = R - 2; r >= 1; r--)
+    {
+        for (int c = 0; c < C; c++)
+        {
+            int digit = (int)(index % 3);
+            index /= 3;
+            if (digit == 1)
+            {
+                p.white |= (Bitboard)1 << (r * C + c);
+            }
+            else if (digit == 2)
+            {
+                p.black |= (Bitboard)1 << (r * C + c);
+            }
+        }
+    }
+    p.white |= (index & rowMask) << ((R - 1) * C);
+    p.black |= (index >> C) & rowMask;
+    Board<R, C>::UpdateStatus(p);
+    return p;
+}
+
+int TablebaseDistance(uint8_t value)
+{
+    return (value & TB_WIN) ? (value & ~TB_WIN) : value - 1;
+}
+
+template <int R, int C>
+int BuildTablebase(const char *fileName, int threads)
+{
+    // Every move takes a pawn one row forward, so there are no cycles and every
+    // position is a win or a loss for the side to move.  Positions are solved
+    // backwards from the end of the game one distance at a time: a position is
+    // won in d + 1 if some move reaches a position lost in d, and lost in d + 1
+    // once its last move has been shown to reach a position won in d.
+    uint64_t size = TablebaseSize<R, C>();
+    if (size == 0)
+    {
+        printf("A %d x %d board is too big for a tablebase.\n", R, C);
+        return 1;
+    }
+
+    printf("Building the %d x %d tablebase (%llu positions) on %d threads.\n", R, C, (unsigned long long)size, threads);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    uint8_t *values = new uint8_t[size];
+    uint8_t *movesLeft = new uint8_t[size]; // Moves not yet shown to reach a win for the opponent
+    memset(values, TB_UNKNOWN, size);
+    memset(movesLeft, 0, size);
+
+    ThreadPool pool;
+    PoolInit(pool, threads);
+
+    // Count the moves of every position, and find the positions lost with no
+    // move at all or won in one by reaching the goal row or taking the last piece
+    std::atomic<uint64_t> legal(0);
+    PoolParallelFor(pool, size, [values, movesLeft, &legal](uint64_t begin, uint64_t end)
+    {
+        uint64_t count = 0;
+        for (uint64_t index = begin; index < end; index++)
+        {
+            Position p = TablebasePosition<R, C>(index);
+            if (p.white == 0 || p.black == 0)
+            {
+                continue; // Already over, never stored
+            }
+            count++;
+
+            Move moves[Board<R, C>::MAX_MOVES];
+            int numMoves = Board<R, C>::GenerateMoves(p, moves);
+            movesLeft[index] = (uint8_t)numMoves;
+            if (numMoves == 0)
+            {
+                values[index] = 1 + 0;
+            }
+            for (int i = 0; i < numMoves; i++)
+            {
+                if (moves[i].wins)
+                {
+                    values[index] = TB_WIN | 1;
+                    break;
+                }
+            }
+        }
+        legal += count;
+    });
+
+    for (int distance = 0; distance < 127; distance++)
+    {
+        std::atomic<uint64_t> found(0);
+        PoolParallelFor(pool, size, [values, movesLeft, distance, &found](uint64_t begin, uint64_t end)
+        {
+            uint64_t count = 0;
+            for (uint64_t index = begin; index < end; index++)
+            {
+                uint8_t value = __atomic_load_n(&values[index], __ATOMIC_RELAXED);
+                if (value == TB_UNKNOWN || TablebaseDistance(value) != distance)
+                {
+                    continue;
+                }
+                count++;
+
+                // Undo each move the other side could have made to get here.  Moving
+                // back onto an empty square, and for the diagonals also putting back
+                // a piece that was taken.
+                Position q = TablebasePosition<R, C>(index);
+                bool lost = !(value & TB_WIN);
+                bool whiteMoved = !q.isWhitePlayer;
+                Bitboard movers = whiteMoved ? q.white : q.black;
+                Bitboard empty = Board<R, C>::ALL_SQUARES & ~(q.white | q.black);
+                int back = whiteMoved ? C : -C; // White moves up the board, so its pieces came from a row below
+                while (movers)
+                {
+                    int to = __builtin_ctzll(movers);
+                    movers &= movers - 1;
+                    int row = to / C;
+                    int col = to % C;
+                    if ((whiteMoved && row == R - 1) || (!whiteMoved && row == 0))
+                    {
+                        continue;
+                    }
+
+                    for (int dc = -1; dc <= 1; dc++)
+                    {
+                        if (col + dc < 0 || col + dc >= C || !(empty & ((Bitboard)1 << (to + back + dc))))
+                        {
+                            continue;
+                        }
+                        for (int capture = 0; capture <= (dc != 0 ? 1 : 0); capture++)
+                        {
+                            Position p = q;
+                            p.isWhitePlayer = whiteMoved;
+                            Bitboard &own = whiteMoved ? p.white : p.black;
+                            Bitboard &enemy = whiteMoved ? p.black : p.white;
+                            own = (own & ~((Bitboard)1 << to)) | ((Bitboard)1 << (to + back + dc));
+                            if (capture)
+                            {
+                                enemy |= (Bitboard)1 << to;
+                            }
+                            Board<R, C>::UpdateStatus(p);
+                            if (Board<R, C>::CheckWinCondition(p) != 0)
+                            {
+                                continue;
+                            }
+
+                            uint64_t previous = TablebaseIndex<R, C>(p);
+                            uint8_t expected = TB_UNKNOWN;
+                            if (lost)
+                            {
+                                __atomic_compare_exchange_n(&values[previous], &expected, (uint8_t)(TB_WIN | (distance + 1)),
+                                                            false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+                            }
+                            else if (__atomic_load_n(&values[previous], __ATOMIC_RELAXED) == TB_UNKNOWN &&
+                                     __atomic_sub_fetch(&movesLeft[previous], 1, __ATOMIC_RELAXED) == 0)
+                            {
+                                __atomic_compare_exchange_n(&values[previous], &expected, (uint8_t)(1 + distance + 1),
+                                                            false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+                            }
+                        }
+                    }
+                }
+            }
+            found += count;
+        });
+
+        if (found == 0 && distance > 1)
+        {
+            break; // Nothing left to build the next distance from
+        }
+    }
+
+    PoolShutdown(pool);
+    delete[] movesLeft;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t won = 0;
+    uint64_t lost = 0;
+    int longest = 0;
+    for (uint64_t index = 0; index < size; index++)
+    {
+        if (values[index] == TB_UNKNOWN)
+        {
+            continue;
+        }
+        if (values[index] & TB_WIN)
+        {
+            won++;
+        }
+        else
+        {
+            lost++;
+        }
+        longest = std::max(longest, TablebaseDistance(values[index]));
+    }
+    printf("Solved %llu positions (%llu won, %llu lost for the side to move, %llu unsolved), longest game %d plies.\n",
+           (unsigned long long)(won + lost), (unsigned long long)won, (unsigned long long)lost,
+           (unsigned long long)(legal - won - lost), longest);
+    printf("%.2f seconds, %.0f positions/sec.\n", seconds, seconds > 0 ? size / seconds : 0.0);
+
+    TablebaseHeader header;
+    memcpy(header.magic, TB_MAGIC, sizeof(header.magic));
+    header.rows = R;
+    header.cols = C;
+    header.positions = size;
+    FILE *file = fopen(fileName, "wb");
+    bool written = file != NULL &&
+                   fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(values, 1, size, file) == size;
+    if (file != NULL)
+    {
+        written = (fclose(file) == 0) && written;
+    }
+    delete[] values;
+
+    if (!written)
+    {
+        printf("Could not write the tablebase to %s.\n", fileName);
+        return 1;
+    }
+    printf("Wrote %s (%llu bytes).\n", fileName, (unsigned long long)(sizeof(header) + size));
+    return 0;
+}
+
+bool TablebaseLoad(Tablebase &tb, const char *fileName)
+{
+    tb.mapping = NULL;
+    tb.values = NULL;
+    tb.probes = 0;
+    tb.hits = 0;
+
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TablebaseHeader))
+    {
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const TablebaseHeader *header = (const TablebaseHeader *)mapping;
+    if (memcmp(header->magic, TB_MAGIC, sizeof(header->magic)) != 0 ||
+        (size_t)info.st_size != sizeof(TablebaseHeader) + header->positions)
+    {
+        munmap(mapping, info.st_size);
+        return false;
+    }
+
+    tb.rows = header->rows;
+    tb.cols = header->cols;
+    tb.positions = header->positions;
+    tb.values = (const uint8_t *)mapping + sizeof(TablebaseHeader);
+    tb.mapping = mapping;
+    tb.mappingBytes = info.st_size;
+    return true;
+}
+
+void TablebaseUnload(Tablebase &tb)
+{
+    if (tb.mapping != NULL)
+    {
+        munmap(tb.mapping, tb.mappingBytes);
+    }
+    tb.mapping = NULL;
+    tb.values = NULL;
+}
+
+template <int R, int C>
+int TablebaseProbe(Tablebase &tb, const Position &p, int *distance)
+{
+    // Only for positions that are not over yet (CheckWinCondition is 0)
+    tb.probes++;
+    uint8_t value = tb.values[TablebaseIndex<R, C>(p)];
+    if (value == TB_UNKNOWN)
+    {
+        return 0;
+    }
+    tb.hits++;
+    if (distance != NULL)
+    {
+        *distance = TablebaseDistance(value);
+    }
+    bool sideToMoveWins = (value & TB_WIN) != 0;
+    return (sideToMoveWins == p.isWhitePlayer) ? 1 : -1;
+}
+
+bool CacheOpen(SolveCache &cache, const char *fileName, int rows, int cols, int megabytes)
+{
+    // Any number of runs may have the file open at once.  Readers never lock: a torn
+    // entry fails its check and is a miss.  Writers take the file lock, and so does
+    // the run that lays out a new file.
+    cache.fileName = fileName;
+    cache.fd = -1;
+    cache.mapping = NULL;
+    cache.probes = 0;
+    cache.hits = 0;
+    cache.stores = 0;
+
+    int fd = open(fileName, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    flock(fd, LOCK_EX);
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size == 0)
+    {
+        uint64_t buckets = 1;
+        while (buckets * 2 * CACHE_BUCKET * sizeof(CacheEntry) <= (uint64_t)megabytes * 1024 * 1024)
+        {
+            buckets *= 2;
+        }
+        CacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+        header.rows = rows;
+        header.cols = cols;
+        header.buckets = buckets;
+        if (ftruncate(fd, sizeof(CacheHeader) + buckets * CACHE_BUCKET * sizeof(CacheEntry)) != 0 ||
+            pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        {
+            flock(fd, LOCK_UN);
+            close(fd);
+            return false;
+        }
+    }
+    bool sized = fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(CacheHeader);
+    flock(fd, LOCK_UN);
+    if (!sized)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+    CacheHeader *header = (CacheHeader *)mapping;
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 || header->rows != rows || header->cols != cols ||
+        header->buckets == 0 || (header->buckets & (header->buckets - 1)) != 0 ||
+        (size_t)info.st_size != sizeof(CacheHeader) + header->buckets * CACHE_BUCKET * sizeof(CacheEntry))
+    {
+        munmap(mapping, info.st_size);
+        close(fd);
+        return false;
+    }
+
+    cache.fd = fd;
+    cache.mapping = mapping;
+    cache.mappingBytes = info.st_size;
+    cache.header = header;
+    cache.entries = (CacheEntry *)((char *)mapping + sizeof(CacheHeader));
+    cache.mask = header->buckets - 1;
+    cache.generation = (uint16_t)header->generation;
+    return true;
+}
+
+bool CacheProbe(SolveCache &cache, uint64_t key, int &value, int &bestFrom, int &bestTo, uint8_t &flags)
+{
+    // Only writes the results on a hit
+    cache.probes++;
+    const CacheEntry *bucket = &cache.entries[(key & cache.mask) * CACHE_BUCKET];
+    for (int i = 0; i < CACHE_BUCKET; i++)
+    {
+        uint64_t data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&bucket[i].check, __ATOMIC_RELAXED);
+        if ((check ^ data) != key || data == 0)
+        {
+            continue;
+        }
+        cache.hits++;
+        value = (int8_t)(data & 0xFF);
+        bestFrom = (int8_t)((data >> 8) & 0xFF);
+        bestTo = (int8_t)((data >> 16) & 0xFF);
+        flags = (uint8_t)((data >> 24) & 0xFF);
+        return true;
+    }
+    return false;
+}
+
+bool CacheBeginWrite(SolveCache &cache)
+{
+    if (flock(cache.fd, LOCK_EX) != 0)
+    {
+        return false;
+    }
+    cache.header->generation++;
+    cache.generation = (uint16_t)cache.header->generation;
+    return true;
+}
+
+void CacheStore(SolveCache &cache, uint64_t key, int value, int bestFrom, int bestTo, uint8_t flags, uint64_t work)
+{
+    // Entries from the oldest run go first, and of those the one that was quickest
+    // to work out.  The root answers are costed in milliseconds and table entries
+    // at nothing, so the answers stay longest.  An answer is never overwritten by a
+    // table entry for the same position.
+    CacheEntry *bucket = &cache.entries[(key & cache.mask) * CACHE_BUCKET];
+    CacheEntry *slot = NULL;
+    uint32_t slotAge = 0;
+    uint64_t slotWork = 0;
+    for (int i = 0; i < CACHE_BUCKET; i++)
+    {
+        uint64_t data = bucket[i].data;
+        if ((bucket[i].check ^ data) == key && data != 0)
+        {
+            if ((((data >> 24) & CACHE_ANSWER) != 0) && !(flags & CACHE_ANSWER))
+            {
+                return;
+            }
+            slot = &bucket[i];
+            break;
+        }
+        uint32_t age = (uint16_t)(cache.generation - (uint16_t)(data >> 32));
+        uint64_t oldWork = data >> 48;
+        if (data == 0)
+        {
+            age = 0x10000; // Empty, use it before anything
+        }
+        if (slot == NULL || age > slotAge || (age == slotAge && oldWork < slotWork))
+        {
+            slot = &bucket[i];
+            slotAge = age;
+            slotWork = oldWork;
+        }
+    }
+
+    uint64_t data = (uint64_t)(uint8_t)(int8_t)value | ((uint64_t)(uint8_t)(int8_t)bestFrom << 8) |
+                    ((uint64_t)(uint8_t)(int8_t)bestTo << 16) | ((uint64_t)flags << 24) |
+                    ((uint64_t)cache.generation << 32) | (std::min(work, (uint64_t)0xFFFF) << 48);
+    __atomic_store_n(&slot->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->check, key ^ data, __ATOMIC_RELAXED);
+    cache.stores++;
+}
+
+void CacheStoreTable(SolveCache &cache, const TranspositionTable &tt, int winValue)
+{
+    // Only results that hold against any window: exact ones, and bounds that can not
+    // get any better (nothing beats a win or is worse than a loss)
+    for (uint64_t i = 0; i < tt.entries.size(); i++)
+    {
+        const TTEntry &entry = tt.entries[i];
+        if (entry.key == 0)
+        {
+            continue;
+        }
+        bool win = entry.value >= winValue && entry.flag != TT_UPPER;
+        bool loss = entry.value <= -winValue && entry.flag != TT_LOWER;
+        if (win || loss)
+        {
+            CacheStore(cache, entry.key, win ? 1 : -1, entry.bestFrom, entry.bestTo, 0, 0);
+        }
+    }
+}
+
+void CacheStoreProofTable(SolveCache &cache, const ProofTable &table)
+{
+    for (uint64_t i = 0; i < table.entries.size(); i++)
+    {
+        const ProofEntry &entry = table.entries[i];
+        if (entry.key != 0 && (entry.pn == 0 || entry.dn == 0))
+        {
+            CacheStore(cache, entry.key, entry.pn == 0 ? 1 : -1, -1, -1, 0, 0);
+        }
+    }
+}
+
+void CacheEndWrite(SolveCache &cache)
+{
+    msync(cache.mapping, cache.mappingBytes, MS_ASYNC);
+    flock(cache.fd, LOCK_UN);
+}
+
+void CacheClose(SolveCache &cache)
+{
+    if (cache.mapping != NULL)
+    {
+        munmap(cache.mapping, cache.mappingBytes);
+    }
+    if (cache.fd >= 0)
+    {
+        close(cache.fd);
+    }
+    cache.mapping = NULL;
+    cache.fd = -1;
+}
+
+template <int R, int C>
+void ProofNumbers(ProofContext *ctx, const Position &p, uint32_t &pn, uint32_t &dn)
+{
+    // A finished game is settled, so is anything the table, tablebase or cache knows,
+    // and so is a position where the side to move can win on the spot.  Everything
+    // else is a fresh leaf that one expansion might settle either way.
+    int winInt = Board<R, C>::CheckWinCondition(p);
+    bool mirrored;
+    uint64_t key = winInt == 0 ? TableKey<R, C>(p, ctx->mirror, mirrored) : 0;
+    if (winInt == 0 && ProofTableProbe(ctx->table, key, pn, dn))
+    {
+        return;
+    }
+    if (winInt == 0 && ctx->tablebase != NULL)
+    {
+        winInt = TablebaseProbe<R, C>(*ctx->tablebase, p, NULL);
+    }
+    int cachedFrom;
+    int cachedTo;
+    uint8_t cachedFlags;
+    if (winInt == 0 && ctx->cache != NULL)
+    {
+        CacheProbe(*ctx->cache, key, winInt, cachedFrom, cachedTo, cachedFlags);
+    }
+    if (winInt != 0)
+    {
+        pn = winInt > 0 ? 0 : PN_INFINITY;
+        dn = winInt > 0 ? PN_INFINITY : 0;
+        return;
+    }
+    Move moves[Board<R, C>::MAX_MOVES];
+    int numMoves = Board<R, C>::GenerateMoves(p, moves);
+    for (int i = 0; i < numMoves; i++)
+    {
+        if (moves[i].wins)
+        {
+            pn = p.isWhitePlayer ? 0 : PN_INFINITY;
+            dn = p.isWhitePlayer ? PN_INFINITY : 0;
+            return;
+        }
+    }
+    pn = 1;
+    dn = 1;
+}
+
+template <int R, int C>
+void ProofNumberSearch(Position &p, uint32_t thresholdPn, uint32_t thresholdDn, ProofContext *ctx)
+{
+    // Depth-first proof-number search (Nagai's df-pn).  White to move is an OR node:
+    // one winning child proves it.  Black to move is an AND node: every child has to
+    // be won.  The child with the smallest proof (OR) or disproof (AND) number is the
+    // cheapest way forward, and it is searched until it stops being the cheapest,
+    // which the thresholds passed down to it say.  Nothing but the table is kept, so
+    // memory is bounded by --tt.  A side with no moves has lost, which the min and
+    // sum over an empty list of children give for free.
+    ctx->nodes++;
+    uint64_t nodesBefore = ctx->nodes;
+    bool mirrored;
+    uint64_t key = TableKey<R, C>(p, ctx->mirror, mirrored);
+    bool isOr = p.isWhitePlayer;
+
+    Move moves[Board<R, C>::MAX_MOVES];
+    int numMoves = Board<R, C>::GenerateMoves(p, moves);
+
+    uint32_t pn = 0;
+    uint32_t dn = 0;
+    while (true)
+    {
+        // Recompute this node's numbers from its children
+        uint64_t sum = 0;
+        uint32_t smallest = PN_INFINITY;
+        uint32_t secondSmallest = PN_INFINITY;
+        int best = -1;
+        uint32_t bestPn = 0;
+        uint32_t bestDn = 0;
+        for (int i = 0; i < numMoves; i++)
+        {
+            uint32_t childPn;
+            uint32_t childDn;
+            Undo undo;
+            MakeMove(p, moves[i], undo);
+            ProofNumbers<R, C>(ctx, p, childPn, childDn);
+            UnmakeMove(p, moves[i], undo);
+
+            uint32_t minimised = isOr ? childPn : childDn;
+            sum += isOr ? childDn : childPn;
+            if (minimised < smallest)
+            {
+                secondSmallest = smallest;
+                smallest = minimised;
+                best = i;
+                bestPn = childPn;
+                bestDn = childDn;
+            }
+            else if (minimised < secondSmallest)
+            {
+                secondSmallest = minimised;
+            }
+        }
+        uint32_t summed = (uint32_t)std::min(sum, (uint64_t)PN_INFINITY);
+        pn = isOr ? smallest : summed;
+        dn = isOr ? summed : smallest;
+
+        if (pn >= thresholdPn || dn >= thresholdDn)
+        {
+            break;
+        }
+
+        // The best child may use up the budget until it gets a quarter worse than the
+        // runner up (the 1 + epsilon trick), so the search does not flip between two
+        // children that are nearly as good
+        uint32_t childThresholdPn;
+        uint32_t childThresholdDn;
+        if (isOr)
+        {
+            childThresholdPn = std::min(thresholdPn, secondSmallest + secondSmallest / 4 + 1);
+            childThresholdDn = (uint32_t)std::min((uint64_t)thresholdDn - dn + bestDn, (uint64_t)PN_INFINITY);
+        }
+        else
+        {
+            childThresholdPn = (uint32_t)std::min((uint64_t)thresholdPn - pn + bestPn, (uint64_t)PN_INFINITY);
+            childThresholdDn = std::min(thresholdDn, secondSmallest + secondSmallest / 4 + 1);
+        }
+
+        Undo undo;
+        MakeMove(p, moves[best], undo);
+        ProofNumberSearch<R, C>(p, childThresholdPn, childThresholdDn, ctx);
+        UnmakeMove(p, moves[best], undo);
+    }
+
+    ProofTableStore(ctx->table, key, pn, dn, ctx->nodes - nodesBefore + 1);
+}
+
+template <int R, int C>
+int ProofNumberSolve(Position &p, ProofContext *ctx)
+{
+    uint32_t pn;
+    uint32_t dn;
+    ProofNumbers<R, C>(ctx, p, pn, dn);
+    while (pn != 0 && dn != 0)
+    {
+        // With infinite thresholds one call settles it, unless the table lost the
+        // result on the way back up, and then the next call picks up from what is left
+        ProofNumberSearch<R, C>(p, PN_INFINITY, PN_INFINITY, ctx);
+        ProofNumbers<R, C>(ctx, p, pn, dn);
+    }
+    return pn == 0 ? 1 : -1;
+}
+
+template <int R, int C>
+int ProofNumberRoot(Position &p, ProofContext *ctx, Move *rootMove)
+{
+    // The root is searched like the tree search's: the children are solved in
+    // generation order and Player A plays the first one that wins, or the last
+    // move if none does.  Below the root it is df-pn all the way.
+    int winInt = Board<R, C>::CheckWinCondition(p);
+    if (winInt != 0)
+    {
+        return winInt;
+    }
+
+    Move moves[Board<R, C>::MAX_MOVES];
+    int numMoves = Board<R, C>::GenerateMoves(p, moves);
+    int value = p.isWhitePlayer ? -1 : 1; // No moves loses
+    for (int i = 0; i < numMoves; i++)
+    {
+        Undo undo;
+        MakeMove(p, moves[i], undo);
+        value = ProofNumberSolve<R, C>(p, ctx);
+        UnmakeMove(p, moves[i], undo);
+        *rootMove = moves[i];
+        if (value == 1)
+        {
+            break;
+        }
+    }
+
+    // Settle the root itself too, so the proof tree can be read back from the table
+    bool mirrored;
+    ProofTableStore(ctx->table, TableKey<R, C>(p, ctx->mirror, mirrored), value > 0 ? 0 : PN_INFINITY, value > 0 ? PN_INFINITY : 0, ctx->nodes);
+    return value;
+}
+
+template <int R, int C>
+uint64_t ProofTreeSize(Position &p, ProofContext *ctx, std::unordered_set<uint64_t> &seen)
+{
+    // Walk the settled tree: where the winner is to move one winning child is
+    // enough, everywhere else every child is part of the proof.  Positions reached
+    // twice are counted once.
+    uint64_t key = PositionKey(p);
+    if (!seen.insert(key).second)
+    {
+        return seen.size();
+    }
+
+    if (Board<R, C>::CheckWinCondition(p) != 0)
+    {
+        return seen.size();
+    }
+    if (ctx->tablebase != NULL && TablebaseProbe<R, C>(*ctx->tablebase, p, NULL) != 0)
+    {
+        return seen.size(); // Settled without expanding it
+    }
+
+    uint32_t pn;
+    uint32_t dn;
+    ProofNumbers<R, C>(ctx, p, pn, dn);
+    if (pn != 0 && dn != 0)
+    {
+        ProofNumberSolve<R, C>(p, ctx); // Lost from the table, settle it again
+        ProofNumbers<R, C>(ctx, p, pn, dn);
+    }
+
+    int winner = pn == 0 ? 1 : -1;
+    bool winnerToMove = (winner > 0) == p.isWhitePlayer;
+
+    Move moves[Board<R, C>::MAX_MOVES];
+    int numMoves = Board<R, C>::GenerateMoves(p, moves);
+    int chosen = -1;
+    for (int i = 0; i < numMoves && winnerToMove && chosen < 0; i++)
+    {
+        Undo undo;
+        MakeMove(p, moves[i], undo);
+        uint32_t childPn;
+        uint32_t childDn;
+        ProofNumbers<R, C>(ctx, p, childPn, childDn);
+        UnmakeMove(p, moves[i], undo);
+        if ((winner > 0 ? childPn : childDn) == 0)
+        {
+            chosen = i;
+        }
+    }
+
+    for (int i = 0; i < numMoves; i++)
+    {
+        if (chosen >= 0 && i != chosen)
+        {
+            continue;
+        }
+        Undo undo;
+        MakeMove(p, moves[i], undo);
+        bool partOfProof = !winnerToMove || chosen >= 0 || ProofNumberSolve<R, C>(p, ctx) == winner;
+        if (partOfProof)
+        {
+            ProofTreeSize<R, C>(p, ctx, seen);
+        }
+        UnmakeMove(p, moves[i], undo);
+        if (partOfProof && winnerToMove)
+        {
+            break;
+        }
+    }
+    return seen.size();
+}
+
+template <int R, int C>
+void OrderingReport(const Position &start, const SolverOptions &options)
+{
+    // Solve the board once per policy with the in place search, each run starting
+    // from an empty table, and report how many positions each one needed.
+    printf("Move ordering on a %d x %d board:\n", R, C);
+    uint64_t baseline = 0;
+    int baselineValue = 0;
+    for (int policy = 0; policy < NUM_ORDER_POLICIES; policy++)
+    {
+        MoveOrdering *ordering = OrderingCreate((OrderPolicy)policy);
+        TranspositionTable tt;
+        SearchContext context;
+        SearchContextInit(context, SolverSearchOptions(options), NULL, ordering);
+        if (options.ttMegabytes > 0)
+        {
+            TTInit(tt, options.ttMegabytes);
+            context.tt = &tt;
+        }
+
+        Position p = start;
+        Move rootMove;
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        int value = InPlaceSearch<R, C>(p, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), &context, 0, &rootMove);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        if (policy == ORDER_NONE)
+        {
+            baseline = ordering->nodes;
+            baselineValue = value;
+        }
+        printf("  %-9s %12llu nodes  %6.1f%% of none  %9.1f ms  result %d%s\n",
+               ORDER_POLICY_NAMES[policy], (unsigned long long)ordering->nodes,
+               baseline > 0 ? 100.0 * ordering->nodes / baseline : 0.0, ms, value,
+               value == baselineValue ? "" : "  MISMATCH");
+        delete ordering;
+    }
+}
+
+template <int R, int C>
+uint64_t Perft(Position &p, int depth)
+{
+    // A won position has no moves: the game is over there, just as it is for the search
+    if (depth == 0)
+    {
+        return 1;
+    }
+    if (Board<R, C>::CheckWinCondition(p) != 0)
+    {
+        return 0;
+    }
+
+    Move moves[Board<R, C>::MAX_MOVES];
+    int numMoves = Board<R, C>::GenerateMoves(p, moves);
+    uint64_t leaves = 0;
+    for (int i = 0; i < numMoves; i++)
+    {
+        Undo undo;
+        MakeMove(p, moves[i], undo);
+        leaves += Perft<R, C>(p, depth - 1);
+        UnmakeMove(p, moves[i], undo);
+    }
+    return leaves;
+}
+
+template <int R, int C>
+uint64_t PerftTree(Node *n, int depth, NodeArena &arena)
+{
+    if (depth == 0)
+    {
+        return 1;
+    }
+    if (Board<R, C>::CheckWinCondition(n->position) != 0)
+    {
+        return 0;
+    }
+
+    // Each call hands its children back to the arena once they are counted, so
+    // only the path down to the current node is ever in memory
+    ArenaMark mark = ArenaGetMark(arena);
+    FindAndMovePieces<R, C>(n, &arena);
+    uint64_t leaves = 0;
+    for (unsigned int i = 0; i < n->children.count; i++)
+    {
+        leaves += PerftTree<R, C>(n->children.items[i], depth - 1, arena);
+    }
+    ArenaRelease(arena, mark);
+    n->children.clear();
+    return leaves;
+}
+
+template <int R, int C>
+void PerftReport(const Position &start, int maxDepth, bool divide)
+{
+    // Count every position reachable in exactly 1, 2, ... maxDepth plies with the
+    // make/unmake generator, then again with the tree generator.  The two have to
+    // agree, and the first count doubles as a move generation benchmark.
+    printf("Perft on a %d x %d board:\n", R, C);
+    printf("Depth            Leaves    Time (ms)       Nodes/sec    Tree generator\n");
+
+    NodeArena arena;
+    ArenaInit(arena, 1 << 20);
+    Node *root = new (ArenaAlloc(arena, sizeof(Node))) Node();
+    root->position = start;
+    root->whiteWinNode = NULL;
+    root->children.clear();
+    ArenaMark rootMark = ArenaGetMark(arena);
+
+    for (int depth = 1; depth <= maxDepth; depth++)
+    {
+        Position p = start;
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        uint64_t leaves = Perft<R, C>(p, depth);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        uint64_t treeLeaves = PerftTree<R, C>(root, depth, arena);
+        ArenaRelease(arena, rootMark);
+
+        printf("%5d  %16llu  %11.1f  %14.0f    %s\n", depth, (unsigned long long)leaves, ms,
+               ms > 0.0 ? leaves * 1000.0 / ms : 0.0, treeLeaves == leaves ? "same" : "MISMATCH");
+        if (treeLeaves != leaves)
+        {
+            printf("       tree generator counted %llu\n", (unsigned long long)treeLeaves);
+        }
+    }
+
+    if (divide)
+    {
+        // The deepest count split by root move, so a mismatch can be chased down one move at a time
+        printf("Divide at depth %d:\n", maxDepth);
+        Position p = start;
+        Move moves[Board<R, C>::MAX_MOVES];
+        int numMoves = 0;
+        if (Board<R, C>::CheckWinCondition(p) == 0)
+        {
+            numMoves = Board<R, C>::GenerateMoves(p, moves);
+        }
+        uint64_t total = 0;
+        for (int i = 0; i < numMoves; i++)
+        {
+            Undo undo;
+            MakeMove(p, moves[i], undo);
+            uint64_t leaves = Perft<R, C>(p, maxDepth - 1);
+            UnmakeMove(p, moves[i], undo);
+            total += leaves;
+
+            Point from = Board<R, C>::SquareToPoint(moves[i].from);
+            Point to = Board<R, C>::SquareToPoint(moves[i].to);
+            printf("  (%d, %d) to (%d, %d): %llu\n", from.r, from.c, to.r, to.c, (unsigned long long)leaves);
+        }
+        printf("  %d moves, %llu leaves\n", numMoves, (unsigned long long)total);
+    }
+
+    ArenaFree(arena);
+}
+
+template <int R, int C>
+void SpeedupReport(const Position &start, int maxThreads, const SolverOptions &options)
+{
+    // With --tt every run, the serial one included, starts from a fresh table of that
+    // size, so the times are those of --threads N --tt MB on this board
+    TranspositionTable tt;
+    SearchContext context;
+    SearchContextInit(context, SolverSearchOptions(options), NULL, NULL);
+    if (options.ttMegabytes > 0)
+    {
+        TTInit(tt, options.ttMegabytes);
+        context.tt = &tt;
+    }
+    Position serial = start;
+    Move serialMove;
+    serialMove.from = -1;
+    serialMove.to = -1;
+    int serialValue = InPlaceSearch<R, C>(serial, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), &context, 0, &serialMove);
+
+    printf("Threads    Time (ms)    Speedup    Value    Same as serial\n");
+    double baseTime = 0.0;
+    for (int threads = 1; ; threads *= 2)
+    {
+        threads = std::min(threads, maxThreads);
+
+        ThreadPool pool;
+        PoolInit(pool, threads);
+        SharedTable *table = NULL;
+        if (options.ttMegabytes > 0)
+        {
+            table = new SharedTable();
+            SharedInit(*table, options.ttMegabytes, threads, options.mirror);
+            SharedNewSearch(*table);
+        }
+        Position p = start;
+        Move rootMove;
+        rootMove.from = -1;
+        rootMove.to = -1;
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        int value = ParallelRootSearch<R, C>(p, &pool, table, &rootMove);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        PoolShutdown(pool);
+        delete table;
+
+        if (threads == 1)
+        {
+            baseTime = ms;
+        }
+        bool same = value == serialValue && rootMove.from == serialMove.from && rootMove.to == serialMove.to;
+        printf("%7d    %9.2f    %6.2fx    %5d    %s\n", threads, ms, ms > 0.0 ? baseTime / ms : 0.0, value, same ? "yes" : "NO");
+
+        if (threads >= maxThreads)
+        {
+            break;
+        }
+    }
+}
+
+int SpeedupReportFiles(const SolverOptions &options)
+{
+    // The same boards as --race-report, each timed with fresh tables of --tt MB, or
+    // with no table at all if --tt was not given
+    int maxThreads = DefaultThreads(options);
+    printf("Parallel search %s:\n", options.ttMegabytes > 0 ? ("with a " + std::to_string(options.ttMegabytes) + " MB shared table").c_str() : "without a table");
+    const char *files[] = { "case_1.txt", "case_2.txt", "case_3.txt", "input.txt" };
+    int boards = 0;
+    for (unsigned int i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        std::vector<BatchBoard> read;
+        if (!ReadBatch(files[i], read))
+        {
+            printf("%s: could not read it, skipped.\n", files[i]);
+            continue;
+        }
+        for (unsigned int j = 0; j < read.size(); j++)
+        {
+            int rows = (int)read[j].lines.size();
+            int cols = (int)read[j].lines[0].size();
+            printf("%s (%d x %d):\n", read[j].name.c_str(), rows, cols);
+            bool supported = false;
+#define SPEEDUP_BOARD(r, c) if (rows == r && cols == c) { Position p; LoadLines<r, c>(p, read[j].lines); SpeedupReport<r, c>(p, maxThreads, options); supported = true; }
+            SUPPORTED_BOARDS(SPEEDUP_BOARD)
+#undef SPEEDUP_BOARD
+            if (!supported)
+            {
+                printf("Unsupported board size, skipped.\n");
+            }
+            boards++;
+        }
+    }
+    return boards > 0 ? 0 : 1;
+}
+
+bool IsCancelled(const CancelScope *scope)
+{
+    for (; scope != NULL; scope = scope->parent)
+    {
+        if (scope->cancelled)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+thread_local int t_threadIndex = 0; // Which queue of the pool belongs to this thread
+
+void PoolInit(ThreadPool &pool, int numThreads)
+{
+    pool.numThreads = numThreads;
+    pool.pending = 0;
+    pool.stop = false;
+    for (int i = 0; i < numThreads; i++)
+    {
+        pool.queues.push_back(new WorkQueue());
+    }
+    t_threadIndex = 0;
+    for (int i = 1; i < numThreads; i++)
+    {
+        pool.workers.push_back(std::thread(PoolWorker, &pool, i));
+    }
+}
+
+void PoolSubmit(ThreadPool &pool, std::function<void()> task)
+{
+    WorkQueue *queue = pool.queues[t_threadIndex];
+    {
+        std::lock_guard<std::mutex> guard(queue->lock);
+        queue->tasks.push_back(task);
+    }
+    pool.pending++;
+
+    std::lock_guard<std::mutex> guard(pool.sleepLock);
+    pool.wakeUp.notify_one();
+}
+
+bool PoolRunPending(ThreadPool &pool)
+{
+    // Newest task from our own queue first (it is the deepest, so it is likely
+    // still hot in cache), otherwise steal the oldest task of another thread
+    std::function<void()> task;
+    int numQueues = (int)pool.queues.size();
+    for (int i = 0; i < numQueues && !task; i++)
+    {
+        int index = (t_threadIndex + i) % numQueues;
+        WorkQueue *queue = pool.queues[index];
+        std::lock_guard<std::mutex> guard(queue->lock);
+        if (queue->tasks.empty())
+        {
+            continue;
+        }
+        if (i == 0)
+        {
+            task = queue->tasks.back();
+            queue->tasks.pop_back();
+        }
+        else
+        {
+            task = queue->tasks.front();
+            queue->tasks.pop_front();
+        }
+    }
+
+    if (!task)
+    {
+        return false;
+    }
+    pool.pending--;
+    task();
+    return true;
+}
+
+void PoolWorker(ThreadPool *pool, int index)
+{
+    t_threadIndex = index;
+    while (true)
+    {
+        if (PoolRunPending(*pool))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(pool->sleepLock);
+        if (pool->stop)
+        {
+            return;
+        }
+        pool->wakeUp.wait(lock, [pool]() { return pool->stop || pool->pending > 0; });
+    }
+}
+
+void PoolShutdown(ThreadPool &pool)
+{
+    {
+        std::lock_guard<std::mutex> guard(pool.sleepLock);
+        pool.stop = true;
+        pool.wakeUp.notify_all();
+    }
+    for (unsigned int i = 0; i < pool.workers.size(); i++)
+    {
+        pool.workers[i].join();
+    }
+    for (unsigned int i = 0; i < pool.queues.size(); i++)
+    {
+        delete pool.queues[i];
+    }
+    pool.workers.clear();
+    pool.queues.clear();
+}
+
+void PoolParallelFor(ThreadPool &pool, uint64_t count, std::function<void(uint64_t, uint64_t)> body)
+{
+    // A few chunks per thread so the stealing can even out chunks that run slow
+    uint64_t numChunks = std::min(count, (uint64_t)pool.numThreads * 16);
+    if (numChunks == 0)
+    {
+        return;
+    }
+    uint64_t chunkSize = (count + numChunks - 1) / numChunks;
+    std::atomic<uint64_t> remaining(0);
+    for (uint64_t begin = 0; begin < count; begin += chunkSize)
+    {
+        uint64_t end = std::min(count, begin + chunkSize);
+        remaining++;
+        std::atomic<uint64_t> *left = &remaining;
+        PoolSubmit(pool, [body, begin, end, left]()
+        {
+            body(begin, end);
+            (*left)--;
+        });
+    }
+
+    while (remaining > 0)
+    {
+        if (!PoolRunPending(pool))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template <int R, int C>
+int MctsSearch(const Position &start, const SolverOptions &options, Move *rootMove, uint64_t &playouts, std::string &summary)
+{
+    // UCT on a fixed pool of nodes, for boards too big to solve.  Every thread runs
+    // playouts into the same tree until the playout count or --movetime runs out, and
+    // the move played the most is the answer.  Only a move that wins on the spot is
+    // proven; anything else comes back as 0, like an unfinished iterative deepening.
+    int megabytes = options.ttMegabytes > 0 ? options.ttMegabytes : MCTS_DEFAULT_MEGABYTES;
+    MctsTree tree;
+    tree.capacity = (uint32_t)std::min((uint64_t)UINT32_MAX, (uint64_t)megabytes * 1024 * 1024 / sizeof(MctsNode));
+    tree.nodes = new MctsNode[tree.capacity];
+    tree.used = 1;
+    tree.playouts = 0;
+    tree.maxPlayouts = options.playouts > 0 ? options.playouts : (options.moveTime > 0 ? 0 : MCTS_DEFAULT_PLAYOUTS);
+    tree.hasDeadline = options.moveTime > 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    tree.deadline = begin + std::chrono::milliseconds(options.moveTime);
+
+    MctsNode &root = tree.nodes[0];
+    root.visits = 0;
+    root.wins = 0;
+    root.firstChild = 0;
+    root.expanding = false;
+    root.numChildren = 0;
+    root.from = -1;
+    root.to = -1;
+    root.ends = false;
+    if (Board<R, C>::CheckWinCondition(start) != 0 || !MctsExpand<R, C>(&tree, root, start) || root.numChildren == 0)
+    {
+        delete[] tree.nodes;
+        summary = "Monte Carlo Tree Search: the game is already over, nothing to search";
+        return Board<R, C>::CheckWinCondition(start);
+    }
+
+    int threads = std::max(1, options.threads);
+    if (threads == 1)
+    {
+        MctsWorker<R, C>(&tree, start, 0);
+    }
+    else
+    {
+        ThreadPool pool;
+        PoolInit(pool, threads);
+        MctsTree *shared = &tree;
+        PoolParallelFor(pool, threads, [shared, &start](uint64_t first, uint64_t last)
+        {
+            for (uint64_t i = first; i < last; i++)
+            {
+                MctsWorker<R, C>(shared, start, i);
+            }
+        });
+        PoolShutdown(pool);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    // Most visited first: with UCT the visit counts are steadier than the win rates
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < root.numChildren; i++)
+    {
+        order.push_back(root.firstChild + i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&tree](uint32_t x, uint32_t y)
+    {
+        return tree.nodes[x].visits > tree.nodes[y].visits;
+    });
+    for (unsigned int i = 0; !options.quiet && i < order.size() && i < (unsigned int)MCTS_REPORT_MOVES; i++)
+    {
+        const MctsNode &child = tree.nodes[order[i]];
+        Point from = Board<R, C>::SquareToPoint(child.from);
+        Point to = Board<R, C>::SquareToPoint(child.to);
+        printf("MCTS: (%d, %d) to (%d, %d), %u playouts, Player A wins %.1f%%\n", from.r, from.c, to.r, to.c,
+               (unsigned int)child.visits, child.visits > 0 ? 100.0 * child.wins / child.visits : 0.0);
+    }
+
+    const MctsNode &best = tree.nodes[order[0]];
+    rootMove->from = best.from;
+    rootMove->to = best.to;
+    rootMove->wins = best.ends;
+    Position after = start;
+    Undo undo;
+    MakeMove(after, *rootMove, undo);
+    int value = Board<R, C>::CheckWinCondition(after) == 1 ? 1 : 0;
+
+    playouts = root.visits;
+    char text[256];
+    snprintf(text, sizeof(text), "Monte Carlo Tree Search: %llu playouts in %.1f ms (%.0f playouts/sec) on %d thread%s, "
+             "%u of %u pool nodes, Player A wins %.1f%% of playouts after the move%s",
+             (unsigned long long)playouts, ms, ms > 0 ? playouts * 1000.0 / ms : 0.0, threads, threads == 1 ? "" : "s",
+             (unsigned int)std::min(tree.used.load(), tree.capacity), tree.capacity,
+             best.visits > 0 ? 100.0 * best.wins / best.visits : 0.0, value == 0 ? " (not proven)" : "");
+    summary = text;
+    delete[] tree.nodes;
+    return value;
+}
+
+template <int R, int C>
+void MctsWorker(MctsTree *tree, const Position &start, uint64_t seed)
+{
+    uint64_t rng = 0x243F6A8885A308D3ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+    for (;;)
+    {
+        if (tree->maxPlayouts > 0 && tree->playouts.fetch_add(1) >= tree->maxPlayouts)
+        {
+            return;
+        }
+        if (tree->hasDeadline && std::chrono::steady_clock::now() >= tree->deadline)
+        {
+            return;
+        }
+        MctsPlayout<R, C>(tree, start, rng);
+    }
+}
+
+template <int R, int C>
+void MctsPlayout(MctsTree *tree, const Position &start, uint64_t &rng)
+{
+    Position p = start;
+    uint32_t path[MAX_PLY];
+    bool whiteMoved[MAX_PLY]; // Did White make the move into path[i]?
+    int length = 1;
+    path[0] = 0;
+    whiteMoved[0] = !start.isWhitePlayer;
+    tree->nodes[0].visits++;
+
+    int winner = 0;
+    for (;;)
+    {
+        MctsNode &n = tree->nodes[path[length - 1]];
+        winner = Board<R, C>::CheckWinCondition(p);
+        if (winner != 0)
+        {
+            break;
+        }
+        uint32_t first = n.firstChild.load(std::memory_order_acquire);
+        if (first == 0)
+        {
+            // Leaves get their children once a few playouts have gone through them;
+            // until then, or while someone else is expanding this one, or once the
+            // pool is full, play out from here instead
+            if (n.visits.load(std::memory_order_relaxed) < MCTS_EXPAND_VISITS || !MctsExpand<R, C>(tree, n, p))
+            {
+                break;
+            }
+            first = n.firstChild.load(std::memory_order_acquire);
+        }
+        if (n.numChildren == 0)
+        {
+            winner = p.isWhitePlayer ? -1 : 1; // No moves: the side to move has lost
+            break;
+        }
+        if (length == MAX_PLY)
+        {
+            break;
+        }
+
+        // UCT, with running playouts counted as losses through their visits
+        double logVisits = log((double)std::max(1u, n.visits.load(std::memory_order_relaxed)));
+        uint32_t chosen = first;
+        double bestScore = -1.0;
+        for (uint32_t i = first; i < first + n.numChildren; i++)
+        {
+            uint32_t visits = tree->nodes[i].visits.load(std::memory_order_relaxed);
+            if (visits == 0)
+            {
+                chosen = i;
+                break;
+            }
+            double score = (double)tree->nodes[i].wins.load(std::memory_order_relaxed) / visits +
+                           MCTS_EXPLORATION * sqrt(logVisits / visits);
+            if (score > bestScore)
+            {
+                bestScore = score;
+                chosen = i;
+            }
+        }
+
+        MctsNode &child = tree->nodes[chosen];
+        child.visits++;
+        Move m;
+        m.from = child.from;
+        m.to = child.to;
+        m.wins = child.ends;
+        whiteMoved[length] = p.isWhitePlayer;
+        path[length++] = chosen;
+        Undo undo;
+        MakeMove(p, m, undo);
+    }
+
+    if (winner == 0)
+    {
+        winner = MctsRollout<R, C>(p, rng);
+    }
+    for (int i = 0; i < length; i++)
+    {
+        if ((winner == 1) == whiteMoved[i])
+        {
+            tree->nodes[path[i]].wins++;
+        }
+    }
+}
+
+template <int R, int C>
+bool MctsExpand(MctsTree *tree, MctsNode &n, const Position &p)
+{
+    if (n.expanding.exchange(true))
+    {
+        return false;
+    }
+    Move moves[Board<R, C>::MAX_MOVES];
+    int numMoves = Board<R, C>::GenerateMoves(p, moves);
+    if (tree->used.load(std::memory_order_relaxed) >= tree->capacity)
+    {
+        return false; // Full already, don't push used any further past it
+    }
+    uint32_t first = tree->used.fetch_add(numMoves);
+    if ((uint64_t)first + numMoves > tree->capacity)
+    {
+        return false; // Stays a leaf for good, expanding is left set
+    }
+    for (int i = 0; i < numMoves; i++)
+    {
+        MctsNode &child = tree->nodes[first + i];
+        child.visits = 0;
+        child.wins = 0;
+        child.firstChild = 0;
+        child.expanding = false;
+        child.numChildren = 0;
+        child.from = (int8_t)moves[i].from;
+        child.to = (int8_t)moves[i].to;
+        child.ends = moves[i].wins;
+    }
+    n.numChildren = (uint8_t)numMoves;
+    n.firstChild.store(numMoves > 0 ? first : UINT32_MAX, std::memory_order_release);
+    return true;
+}
+
+template <int R, int C>
+int MctsRollout(Position &p, uint64_t &rng)
+{
+    // Light guidance only: a move that ends the game is always taken, and a pawn
+    // RaceWinner says can not be stopped ends the playout early
+    for (;;)
+    {
+        int winner = Board<R, C>::CheckWinCondition(p);
+        if (winner != 0)
+        {
+            return winner;
+        }
+        winner = Board<R, C>::RaceWinner(p);
+        if (winner != 0)
+        {
+            return winner;
+        }
+        Move moves[Board<R, C>::MAX_MOVES];
+        int numMoves = Board<R, C>::GenerateMoves(p, moves);
+        if (numMoves == 0)
+        {
+            return p.isWhitePlayer ? -1 : 1;
+        }
+        int chosen = (int)(SplitMix64(rng) % numMoves);
+        for (int i = 0; i < numMoves; i++)
+        {
+            if (moves[i].wins)
+            {
+                chosen = i;
+                break;
+            }
+        }
+        Undo undo;
+        MakeMove(p, moves[chosen], undo);
+    }
+}
+
+bool ParseEngine(const char *text, MatchEngine &engine)
+{
+    engine.name = text;
+    const char *colon = strchr(text, ':');
+    size_t length = colon != NULL ? (size_t)(colon - text) : strlen(text);
+    for (int kind = 0; kind < NUM_ENGINE_KINDS; kind++)
+    {
+        if (strlen(ENGINE_KIND_NAMES[kind]) == length && strncmp(text, ENGINE_KIND_NAMES[kind], length) == 0)
+        {
+            engine.kind = (EngineKind)kind;
+            engine.limit = colon != NULL ? strtoull(colon + 1, NULL, 10) : 0;
+            // Solve and random take no limit, the others need one
+            return (engine.kind == ENGINE_SOLVE || engine.kind == ENGINE_RANDOM) ? colon == NULL : engine.limit > 0;
+        }
+    }
+    return false;
+}
+
+template <int R, int C>
+int RunMatch(const SolverOptions &options)
+{
+    // Every opening is played twice, once with each engine as White, so a board that
+    // favours one side does not favour either engine.  Games run side by side on the
+    // pool, one per task, and each engine searches single threaded.
+    MatchEngine engines[2];
+    for (int i = 0; i < 2; i++)
+    {
+        if (!ParseEngine(options.match[i], engines[i]))
+        {
+            printf("Unknown engine %s, use solve, depth:PLIES, time:MS, mcts:PLAYOUTS or random.\n", options.match[i]);
+            return 1;
+        }
+    }
+    int games = options.matchGames;
+    int numOpenings = (games + 1) / 2;
+    std::vector<Position> openings(numOpenings);
+    for (int i = 0; i < numOpenings; i++)
+    {
+        MatchOpening<R, C>(i, openings[i]);
+    }
+
+    SolverOptions engineOptions = options;
+    engineOptions.quiet = true;
+    engineOptions.threads = 0;
+    if (engineOptions.ttMegabytes == 0)
+    {
+        engineOptions.ttMegabytes = MATCH_DEFAULT_MEGABYTES;
+    }
+    int threads = DefaultThreads(options);
+    printf("Match on a %d x %d board: %s against %s, %d games from %d openings on %d thread%s\n", R, C,
+           engines[0].name, engines[1].name, games, numOpenings, threads, threads == 1 ? "" : "s");
+
+    std::vector<MatchGame> results(games);
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    ThreadPool pool;
+    PoolInit(pool, threads);
+    const MatchEngine *engineList = engines;
+    PoolParallelFor(pool, games, [&](uint64_t first, uint64_t last)
+    {
+        for (uint64_t g = first; g < last; g++)
+        {
+            results[g].opening = (int)(g / 2);
+            results[g].whiteEngine = (int)(g % 2);
+            PlayMatchGame<R, C>(engineOptions, engineList, openings[g / 2], results[g]);
+        }
+    });
+    PoolShutdown(pool);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    int wins[2] = { 0, 0 };
+    int whiteGames[2] = { 0, 0 };
+    int whiteWins[2] = { 0, 0 };
+    int moves[2] = { 0, 0 };
+    uint64_t nodes[2] = { 0, 0 };
+    double milliseconds[2] = { 0, 0 };
+    uint64_t plies = 0;
+    for (int g = 0; g < games; g++)
+    {
+        const MatchGame &game = results[g];
+        wins[game.winner]++;
+        whiteGames[game.whiteEngine]++;
+        whiteWins[game.whiteEngine] += game.winner == game.whiteEngine ? 1 : 0;
+        plies += game.plies;
+        for (int e = 0; e < 2; e++)
+        {
+            moves[e] += game.moves[e];
+            nodes[e] += game.nodes[e];
+            milliseconds[e] += game.milliseconds[e];
+        }
+    }
+
+    for (int e = 0; e < 2; e++)
+    {
+        double low;
+        double high;
+        WilsonInterval(wins[e], games, low, high);
+        printf("  %-16s wins %d of %d (%.1f%%, 95%% CI %.1f%% to %.1f%%), %d of %d as White, %d of %d as Black\n",
+               engines[e].name, wins[e], games, 100.0 * wins[e] / games, 100.0 * low, 100.0 * high,
+               whiteWins[e], whiteGames[e], wins[e] - whiteWins[e], games - whiteGames[e]);
+    }
+    for (int e = 0; e < 2; e++)
+    {
+        printf("  %-16s %d moves, %.0f nodes/move, %.2f ms/move\n", engines[e].name, moves[e],
+               moves[e] > 0 ? (double)nodes[e] / moves[e] : 0.0, moves[e] > 0 ? milliseconds[e] / moves[e] : 0.0);
+    }
+    printf("  %d games (%.1f plies each) in %.2f s, %.2f games/sec\n", games, (double)plies / games, seconds,
+           seconds > 0 ? games / seconds : 0.0);
+    return 0;
+}
+
+template <int R, int C>
+void MatchOpening(int index, Position &p)
+{
+    // Opening 0 is the default layout.  The rest are a few random plies into the
+    // game from it, skipping any that end the game, the same for every run.
+    Board<R, C>::LoadDefaultBoard(p);
+    Board<R, C>::UpdateStatus(p);
+    p.isWhitePlayer = true;
+    uint64_t rng = (uint64_t)index * 0x9E3779B97F4A7C15ULL;
+    for (int ply = 0; index > 0 && ply < MATCH_OPENING_PLIES; ply++)
+    {
+        Move moves[Board<R, C>::MAX_MOVES];
+        int numMoves = Board<R, C>::GenerateMoves(p, moves);
+        int quiet = 0;
+        for (int i = 0; i < numMoves; i++)
+        {
+            if (!moves[i].wins)
+            {
+                moves[quiet++] = moves[i];
+            }
+        }
+        if (quiet == 0)
+        {
+            return;
+        }
+        Undo undo;
+        MakeMove(p, moves[SplitMix64(rng) % quiet], undo);
+    }
+}
+
+template <int R, int C>
+void PlayMatchGame(const SolverOptions &options, const MatchEngine *engines, const Position &opening, MatchGame &game)
+{
+    // Each engine keeps its own table for the whole game, so what it proved on one
+    // move still helps on the next
+    TranspositionTable tables[2];
+    for (int e = 0; e < 2; e++)
+    {
+        if (engines[e].kind == ENGINE_SOLVE || engines[e].kind == ENGINE_DEPTH || engines[e].kind == ENGINE_TIME)
+        {
+            TTInit(tables[e], options.ttMegabytes);
+        }
+        game.moves[e] = 0;
+        game.nodes[e] = 0;
+        game.milliseconds[e] = 0;
+    }
+    uint64_t rng = ((uint64_t)game.opening * 2 + game.whiteEngine) * 0x9E3779B97F4A7C15ULL; // Random moves, the same every run
+    Position p = opening;
+    game.plies = 0;
+    for (;;)
+    {
+        int winner = Board<R, C>::CheckWinCondition(p);
+        Move moves[Board<R, C>::MAX_MOVES];
+        if (winner == 0 && Board<R, C>::GenerateMoves(p, moves) == 0)
+        {
+            winner = p.isWhitePlayer ? -1 : 1; // No moves: the side to move has lost
+        }
+        if (winner != 0)
+        {
+            game.winner = winner == 1 ? game.whiteEngine : 1 - game.whiteEngine;
+            return;
+        }
+
+        int e = p.isWhitePlayer ? game.whiteEngine : 1 - game.whiteEngine;
+        uint64_t nodes = 0;
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        Move m = EngineMove<R, C>(options, engines[e], p, engines[e].kind == ENGINE_MCTS || engines[e].kind == ENGINE_RANDOM ? NULL : &tables[e], rng, nodes);
+        game.milliseconds[e] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        game.nodes[e] += nodes;
+        game.moves[e]++;
+        game.plies++;
+        Undo undo;
+        MakeMove(p, m, undo);
+    }
+}
+
+template <int R, int C>
+Move EngineMove(const SolverOptions &options, const MatchEngine &engine, const Position &start, TranspositionTable *tt,
+                uint64_t &rng, uint64_t &nodes)
+{
+    Position p = start;
+    Move best;
+    best.from = -1;
+    best.to = -1;
+    best.wins = false;
+    if (engine.kind == ENGINE_RANDOM)
+    {
+        Move moves[Board<R, C>::MAX_MOVES];
+        int numMoves = Board<R, C>::GenerateMoves(p, moves);
+        return moves[SplitMix64(rng) % numMoves];
+    }
+    if (engine.kind == ENGINE_MCTS)
+    {
+        SolverOptions mctsOptions = options;
+        mctsOptions.playouts = engine.limit;
+        mctsOptions.moveTime = 0;
+        std::string summary;
+        MctsSearch<R, C>(p, mctsOptions, &best, nodes, summary);
+        return best;
+    }
+
+    MoveOrdering *ordering = OrderingCreate(options.order); // Counts the nodes even with no ordering
+    if (engine.kind == ENGINE_SOLVE)
+    {
+        SearchContext context;
+        SearchContextInit(context, SolverSearchOptions(options), tt, ordering);
+        InPlaceSearch<R, C>(p, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), &context, 0, &best);
+    }
+    else
+    {
+        SolverOptions deepeningOptions = options;
+        deepeningOptions.maxDepth = engine.kind == ENGINE_DEPTH ? (int)std::min(engine.limit, (uint64_t)MAX_PLY - 1) : 0;
+        deepeningOptions.moveTime = engine.kind == ENGINE_TIME ? (int)std::min(engine.limit, (uint64_t)INT32_MAX) : 0;
+        IterativeDeepening<R, C>(p, deepeningOptions, tt, ordering, &best);
+    }
+    nodes = ordering->nodes;
+    delete ordering;
+    return best;
+}
+
+void WilsonInterval(int wins, int games, double &low, double &high)
+{
+    // Wilson score interval: unlike p +- z * sqrt(p(1 - p) / n) it stays inside
+    // [0, 1] and is still sensible at 0 or n wins out of a few games
+    double n = games;
+    double p = games > 0 ? wins / n : 0.0;
+    double z2 = MATCH_CONFIDENCE_Z * MATCH_CONFIDENCE_Z;
+    double centre = (p + z2 / (2 * n)) / (1 + z2 / n);
+    double spread = MATCH_CONFIDENCE_Z * sqrt(p * (1 - p) / n + z2 / (4 * n * n)) / (1 + z2 / n);
+    low = std::max(0.0, centre - spread);
+    high = std::min(1.0, centre + spread);
+}
+
+template <int R, int C>
+void PrintList(Node *n)
+{
+    PrintList<R, C>(n, NULL);
+}
+
+template <int R, int C>
+void PrintList(Node *n, TraceWriter *trace)
+{
+    for (int i = 0; i < Board<R, C>::ROWS; i++)
+    {
+        for (int j = 0; j < Board<R, C>::COLS; j++)
+        {
+            TracePrint(trace, "[%c]", Board<R, C>::GetSquare(n->position, i, j));
+        }
+        TracePrint(trace, "\n");
+    }
+
+    return;
+}
+
+template <int R, int C>
+bool LoadFile(Node *n)
+{
+    return LoadFileCustom<R, C>(n, "input.txt");
+}
+
+template <int R, int C>
+bool LoadFileCustom(Node *n, std::string fileName)
+{
+    std::ifstream file(fileName.c_str());
+
+    bool fullyLoaded = false;
+
+    if (file.is_open())
+    {
+        n->position.white = 0;
+        n->position.black = 0;
+        n->position.key = 0;
+        for (int i = 0; i < Board<R, C>::ROWS; i++)
+        {
+            std::string line = "";
+            getline(file, line);
+            for (int j = 0; j < Board<R, C>::COLS && j < (int)line.size(); j++)
+            {
+                Board<R, C>::SetSquare(n->position, i, j, line[j]);
+            }
+        }
+        Board<R, C>::UpdateStatus(n->position); // In case the file had no squares at all
+        fullyLoaded = true;
+    }
+    else
+    {
+        std::cout << "NO FILE FOUND, LOADING IN DEFAULT CONFIGURATION!" << std::endl;
+        Board<R, C>::LoadDefaultBoard(n->position);
+        fullyLoaded = true;
+    }
+
+    file.close();
+
+    return fullyLoaded;
+}
+
+bool ReadBoardSize(std::string fileName, int &rows, int &cols)
+{
+    // One line per row, the first line sets the number of columns
+    std::ifstream file(fileName.c_str());
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    int numRows = 0;
+    int numCols = 0;
+    std::string line = "";
+    while (getline(file, line))
+    {
+        if (!line.empty() && line[line.size() - 1] == '\r')
+        {
+            line.erase(line.size() - 1);
+        }
+        if (line.empty())
+        {
+            break;
+        }
+        if (numRows == 0)
+        {
+            numCols = (int)line.size();
+        }
+        numRows++;
+    }
+    file.close();
+
+    if (numRows == 0)
+    {
+        return false;
+    }
+
+    rows = numRows;
+    cols = numCols;
+    return true;
+}
+
+bool TraceOpen(TraceWriter &trace, TraceLevel level, const char *fileName)
+{
+    trace.level = level;
+    trace.file = stdout;
+    trace.buffer = NULL;
+    trace.used = 0;
+    if (level == TRACE_OFF)
+    {
+        return true;
+    }
+    if (fileName != NULL)
+    {
+        trace.file = fopen(fileName, "wb");
+        if (trace.file == NULL)
+        {
+            return false;
+        }
+    }
+    trace.buffer = new char[TRACE_BUFFER_BYTES];
+    return true;
+}
+
+bool TraceEnabled(const TraceWriter *trace, int ply)
+{
+    if (trace == NULL)
+    {
+        return true;
+    }
+    return trace->level == TRACE_FULL || (trace->level == TRACE_ROOT && ply == 0);
+}
+
+void TracePrint(TraceWriter *trace, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    if (trace == NULL)
+    {
+        vprintf(format, args);
+        va_end(args);
+        return;
+    }
+
+    // Format straight into the buffer, and if it did not fit, flush and go again
+    size_t space = TRACE_BUFFER_BYTES - trace->used;
+    va_list retry;
+    va_copy(retry, args);
+    int length = vsnprintf(trace->buffer + trace->used, space, format, args);
+    if (length >= 0 && (size_t)length >= space)
+    {
+        TraceFlush(trace);
+        length = vsnprintf(trace->buffer, TRACE_BUFFER_BYTES, format, retry);
+        if (length >= 0 && (size_t)length >= TRACE_BUFFER_BYTES)
+        {
+            length = 0; // Longer than the whole buffer, nothing the search prints is
+        }
+    }
+    if (length > 0)
+    {
+        trace->used += length;
+    }
+    va_end(retry);
+    va_end(args);
+}
+
+void TraceFlush(TraceWriter *trace)
+{
+    if (trace->used > 0)
+    {
+        fwrite(trace->buffer, 1, trace->used, trace->file);
+        trace->used = 0;
+    }
+}
+
+void TraceClose(TraceWriter &trace)
+{
+    if (trace.buffer == NULL)
+    {
+        return;
+    }
+    TraceFlush(&trace);
+    fflush(trace.file);
+    if (trace.file != stdout)
+    {
+        fclose(trace.file);
+    }
+    delete[] trace.buffer;
+    trace.buffer = NULL;
+}
+
+template <int R, int C>
+void LoadLines(Position &p, const std::vector<std::string> &lines)
+{
+    p.white = 0;
+    p.black = 0;
+    p.key = 0;
+    p.isWhitePlayer = true;
+    for (int i = 0; i < R && i < (int)lines.size(); i++)
+    {
+        for (int j = 0; j < C && j < (int)lines[i].size(); j++)
+        {
+            Board<R, C>::SetSquare(p, i, j, lines[i][j]);
+        }
+    }
+    Board<R, C>::UpdateStatus(p);
+}
+
+bool ReadBatch(const char *path, std::vector<BatchBoard> &boards)
+{
+    // A directory holds one board per file, taken in name order.  Anything else is
+    // one file of boards, each a block of rows ending at a blank line.
+    std::vector<std::string> files;
+    bool isDirectory = false;
+    DIR *dir = opendir(path);
+    if (dir != NULL)
+    {
+        isDirectory = true;
+        struct dirent *item;
+        while ((item = readdir(dir)) != NULL)
+        {
+            std::string fullName = std::string(path) + "/" + item->d_name;
+            struct stat info;
+            if (stat(fullName.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+            {
+                files.push_back(item->d_name);
+            }
+        }
+        closedir(dir);
+        std::sort(files.begin(), files.end());
+    }
+    else
+    {
+        files.push_back(path);
+    }
+
+    for (unsigned int f = 0; f < files.size(); f++)
+    {
+        std::string fileName = isDirectory ? std::string(path) + "/" + files[f] : files[f];
+        std::ifstream file(fileName.c_str());
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        BatchBoard board;
+        board.result.solved = false;
+        int numInFile = 0;
+        std::string line = "";
+        bool more = true;
+        while (more)
+        {
+            more = (bool)getline(file, line);
+            if (!line.empty() && line[line.size() - 1] == '\r')
+            {
+                line.erase(line.size() - 1);
+            }
+            if (more && !line.empty())
+            {
+                board.lines.push_back(line);
+                continue;
+            }
+            if (!board.lines.empty())
+            {
+                numInFile++;
+                char number[32];
+                snprintf(number, sizeof(number), ":%d", numInFile);
+                board.name = isDirectory ? files[f] : fileName + number;
+                boards.push_back(board);
+                board.lines.clear();
+                if (isDirectory)
+                {
+                    break; // Only the first board of each file, like input.txt
+                }
+            }
+        }
+        file.close();
+    }
+    return true;
+}
+
+template <int R, int C>
+void SolveLines(const std::vector<std::string> &lines, const SearchOptions &options, TranspositionTable *tt,
+                const Tablebase *tablebase, SolveResult &result)
+{
+    Position p;
+    LoadLines<R, C>(p, lines);
+
+    // Everything the search writes to is this call's own, so boards can be solved side by side
+    // The cache is shared by every board at once, so batches do without it
+    MoveOrdering *ordering = OrderingCreate(options.order); // Counts the nodes even with no ordering
+    Tablebase localTablebase;
+    SearchContext context;
+    SearchContextInit(context, options, tt, ordering);
+    if (tablebase != NULL && tablebase->rows == R && tablebase->cols == C)
+    {
+        localTablebase = *tablebase; // Shares the mapping, keeps its own probe counts
+        context.tablebase = &localTablebase;
+    }
+
+    uint64_t probesBefore = (tt != NULL) ? tt->probes : 0;
+    uint64_t hitsBefore = (tt != NULL) ? tt->hits : 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Move best;
+    best.from = -1;
+    best.to = -1;
+    result.value = InPlaceSearch<R, C>(p, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), &context, 0, &best);
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    result.nodes = ordering->nodes;
+    result.tableProbes = (tt != NULL) ? tt->probes - probesBefore : 0;
+    result.tableHits = (tt != NULL) ? tt->hits - hitsBefore : 0;
+    result.hasMove = best.from >= 0;
+    result.pv.clear();
+    if (result.hasMove)
+    {
+        PrincipalVariation<R, C>(p, best, &context, result.pv);
+        result.best = result.pv[0];
+    }
+    result.solved = true;
+    delete ordering;
+}
+
+template <int R, int C>
+void PrincipalVariation(const Position &start, Move first, SearchContext *ctx, std::vector<SolveMove> &pv)
+{
+    // Follow the best move the table stored for each position.  Where it has been
+    // replaced, or does not fit the position (a key collision), the moves are searched
+    // again against the table and the first win for the side to move is taken.
+    // Without a table the line stops after the first move.
+    Position p = start;
+    Move m = first;
+    while ((int)pv.size() < MAX_PLY)
+    {
+        SolveMove step;
+        step.fromRow = m.from / C;
+        step.fromCol = m.from % C;
+        step.toRow = m.to / C;
+        step.toCol = m.to % C;
+        pv.push_back(step);
+
+        Undo undo;
+        MakeMove(p, m, undo);
+        if (ctx->tt == NULL || Board<R, C>::CheckWinCondition(p) != 0)
+        {
+            return;
+        }
+
+        Move moves[Board<R, C>::MAX_MOVES];
+        int numMoves = Board<R, C>::GenerateMoves(p, moves);
+        TTEntry entry;
+        bool mirrored = false;
+        int next = numMoves;
+        if (TTProbe(*ctx->tt, TableKey<R, C>(p, ctx->mirror, mirrored), entry) && entry.bestFrom >= 0)
+        {
+            int from = mirrored ? Board<R, C>::MirrorSquare(entry.bestFrom) : entry.bestFrom;
+            int to = mirrored ? Board<R, C>::MirrorSquare(entry.bestTo) : entry.bestTo;
+            next = 0;
+            while (next < numMoves && (moves[next].from != from || moves[next].to != to))
+            {
+                next++;
+            }
+        }
+        for (int i = 0; next == numMoves && i < numMoves; i++)
+        {
+            Undo childUndo;
+            MakeMove(p, moves[i], childUndo);
+            int childValue = InPlaceSearch<R, C>(p, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), ctx, 1, NULL);
+            UnmakeMove(p, moves[i], childUndo);
+            if (childValue == (p.isWhitePlayer ? 1 : -1))
+            {
+                next = i;
+            }
+        }
+        m = moves[next == numMoves ? 0 : next];
+    }
+}
+
+template <int R, int C>
+void SolveBatchBoard(BatchBoard &board, const SolverOptions &options, const Tablebase *tablebase)
+{
+    SolveBatchBoard<R, C>(board, options, tablebase, NULL);
+}
+
+template <int R, int C>
+void SolveBatchBoard(BatchBoard &board, const SolverOptions &options, const Tablebase *tablebase, TranspositionTable *warm)
+{
+    SearchOptions searchOptions = SolverSearchOptions(options);
+    TranspositionTable tt;
+    if (warm == NULL && options.ttMegabytes > 0)
+    {
+        TTInit(tt, options.ttMegabytes);
+        warm = &tt;
+    }
+    // A warm table only holds positions solved to the end of the game, so it stays good
+    SolveLines<R, C>(board.lines, searchOptions, warm, tablebase, board.result);
+}
+
+void SolveBatchBoardAnySize(BatchBoard &board, const SolverOptions &options, const Tablebase *tablebase)
+{
+    int rows = (int)board.lines.size();
+    int cols = (int)board.lines[0].size();
+#define SOLVE_BOARD(r, c) if (rows == r && cols == c) { SolveBatchBoard<r, c>(board, options, tablebase); return; }
+    SUPPORTED_BOARDS(SOLVE_BOARD)
+#undef SOLVE_BOARD
+}
+
+void SearchOptionsInit(SearchOptions &options)
+{
+    options.ttMegabytes = SOLVE_DEFAULT_MEGABYTES;
+    options.mirror = true;
+    options.order = ORDER_NONE;
+    options.race = false;
+}
+
+SolveResult Solve(const std::vector<std::string> &rows, const SearchOptions &options)
+{
+    SolverContext *context = SolverCreate();
+    SolveResult result = Solve(context, rows, options);
+    SolverDestroy(context);
+    return result;
+}
+
+SolverContext *SolverCreate()
+{
+    // The Zobrist keys are the only tables shared between contexts, and they never change once made
+    static std::once_flag zobristOnce;
+    std::call_once(zobristOnce, InitZobristKeys);
+    return new SolverContext();
+}
+
+void SolverDestroy(SolverContext *context)
+{
+    for (std::map<int, TranspositionTable *>::iterator t = context->tables.begin(); t != context->tables.end(); ++t)
+    {
+        delete t->second;
+    }
+    delete context;
+}
+
+SolveResult Solve(SolverContext *context, const std::vector<std::string> &rows, const SearchOptions &options)
+{
+    SolveResult result;
+    result.solved = false;
+    result.value = 0;
+    result.hasMove = false;
+    result.nodes = 0;
+    result.tableProbes = 0;
+    result.tableHits = 0;
+    result.milliseconds = 0;
+    if (rows.empty() || rows[0].empty())
+    {
+        result.error = "empty board";
+        return result;
+    }
+    for (unsigned int i = 1; i < rows.size(); i++)
+    {
+        if (rows[i].size() != rows[0].size())
+        {
+            result.error = "every row has to be the same length";
+            return result;
+        }
+    }
+
+    // Canonical and plain keys don't mix, so each mirror setting has its own table
+    int numRows = (int)rows.size();
+    int numCols = (int)rows[0].size();
+#define SOLVE_BOARD(r, c) \
+    if (numRows == r && numCols == c) \
+    { \
+        TranspositionTable *tt = NULL; \
+        if (options.ttMegabytes > 0) \
+        { \
+            TranspositionTable *&table = context->tables[(r * 100 + c) * 2 + (options.mirror ? 1 : 0)]; \
+            if (table == NULL) \
+            { \
+                table = new TranspositionTable(); \
+                TTInit(*table, options.ttMegabytes); \
+            } \
+            tt = table; \
+        } \
+        SolveLines<r, c>(rows, options, tt, NULL, result); \
+        return result; \
+    }
+    SUPPORTED_BOARDS(SOLVE_BOARD)
+#undef SOLVE_BOARD
+
+    char error[64];
+    snprintf(error, sizeof(error), "unsupported board size %d x %d", numRows, numCols);
+    result.error = error;
+    return result;
+}
+
+void RaceBoard(int rows, int cols, uint64_t &seed, std::vector<std::string> &lines)
+{
+    // A few pieces a side, none of them on its goal row yet, so the game is still on
+    // and there is room for a race
+    lines.assign(rows, std::string(cols, 'X'));
+    for (int color = 0; color < 2; color++)
+    {
+        int pieces = 1 + (int)(SplitMix64(seed) % RACE_REPORT_PIECES);
+        while (pieces > 0)
+        {
+            int r = (color == 0 ? 1 : 0) + (int)(SplitMix64(seed) % (rows - 1));
+            int c = (int)(SplitMix64(seed) % cols);
+            if (lines[r][c] == 'X')
+            {
+                lines[r][c] = color == 0 ? 'W' : 'B';
+                pieces--;
+            }
+        }
+    }
+}
+
+int RaceReport(const SolverOptions &options)
+{
+    // Every board is solved twice from an empty table, without the race test and
+    // with it.  The answers have to agree; the node counts show what the test saves.
+    std::vector<BatchBoard> boards;
+    const char *bundled[] = { "case_1.txt", "case_2.txt", "case_3.txt", "input.txt" };
+    for (unsigned int i = 0; i < sizeof(bundled) / sizeof(bundled[0]); i++)
+    {
+        std::vector<BatchBoard> read;
+        if (ReadBatch(bundled[i], read))
+        {
+            boards.insert(boards.end(), read.begin(), read.end());
+        }
+    }
+    const int sizes[][2] = { { 6, 4 }, { 8, 4 }, { 6, 5 }, { 6, 6 } };
+    uint64_t seed = 0x5EED;
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        for (int j = 0; j < RACE_REPORT_BOARDS; j++)
+        {
+            BatchBoard board;
+            char name[32];
+            snprintf(name, sizeof(name), "random %dx%d #%d", sizes[i][0], sizes[i][1], j + 1);
+            board.name = name;
+            RaceBoard(sizes[i][0], sizes[i][1], seed, board.lines);
+            boards.push_back(board);
+        }
+    }
+
+    SearchOptions searchOptions = SolverSearchOptions(options);
+    searchOptions.ttMegabytes = options.ttMegabytes > 0 ? options.ttMegabytes : SOLVE_DEFAULT_MEGABYTES;
+
+    printf("Race test, %d MB table:\n", searchOptions.ttMegabytes);
+    printf("  %-16s %12s %12s %7s %9s %9s  result\n", "board", "nodes", "with race", "saved", "ms", "with race");
+    uint64_t totalOff = 0;
+    uint64_t totalOn = 0;
+    double msOff = 0;
+    double msOn = 0;
+    int mismatches = 0;
+    for (unsigned int i = 0; i < boards.size(); i++)
+    {
+        searchOptions.race = false;
+        SolveResult off = Solve(boards[i].lines, searchOptions);
+        searchOptions.race = true;
+        SolveResult on = Solve(boards[i].lines, searchOptions);
+        if (!off.solved || !on.solved)
+        {
+            printf("  %-16s %s\n", boards[i].name.c_str(), off.error.c_str());
+            continue;
+        }
+        // The race test only cuts off lines that are won anyway, so the value has
+        // to be the same; the move may differ when more than one wins
+        bool same = off.value == on.value;
+        mismatches += same ? 0 : 1;
+        totalOff += off.nodes;
+        totalOn += on.nodes;
+        msOff += off.milliseconds;
+        msOn += on.milliseconds;
+        printf("  %-16s %12llu %12llu %6.1f%% %9.1f %9.1f  %d%s\n", boards[i].name.c_str(),
+               (unsigned long long)off.nodes, (unsigned long long)on.nodes,
+               off.nodes > 0 ? 100.0 - 100.0 * on.nodes / off.nodes : 0.0,
+               off.milliseconds, on.milliseconds, on.value, same ? "" : "  MISMATCH");
+    }
+    printf("  %-16s %12llu %12llu %6.1f%% %9.1f %9.1f\n", "total",
+           (unsigned long long)totalOff, (unsigned long long)totalOn,
+           totalOff > 0 ? 100.0 - 100.0 * totalOn / totalOff : 0.0, msOff, msOn);
+    return mismatches == 0 ? 0 : 1;
+}
+
+int RunBatch(const SolverOptions &options)
+{
+    std::vector<BatchBoard> boards;
+    if (!ReadBatch(options.batch, boards))
+    {
+        printf("Could not read the batch %s.\n", options.batch);
+        return 1;
+    }
+
+    Tablebase tablebase;
+    Tablebase *loaded = NULL;
+    if (options.tablebaseFile != NULL)
+    {
+        if (TablebaseLoad(tablebase, options.tablebaseFile))
+        {
+            loaded = &tablebase;
+        }
+        else
+        {
+            printf("Could not load the tablebase %s, searching without it.\n", options.tablebaseFile);
+        }
+    }
+
+    int threads = DefaultThreads(options);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ThreadPool pool;
+    PoolInit(pool, threads);
+    BatchBoard *first = boards.empty() ? NULL : &boards[0];
+    PoolParallelFor(pool, boards.size(), [first, &options, loaded](uint64_t begin, uint64_t end)
+    {
+        for (uint64_t i = begin; i < end; i++)
+        {
+            SolveBatchBoardAnySize(first[i], options, loaded);
+        }
+    });
+    PoolShutdown(pool);
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    for (unsigned int i = 0; i < boards.size(); i++)
+    {
+        const BatchBoard &board = boards[i];
+        const SolveResult &result = board.result;
+        if (!result.solved)
+        {
+            printf("%s: unsupported board size %d x %d\n", board.name.c_str(), (int)board.lines.size(), (int)board.lines[0].size());
+            continue;
+        }
+        if (!result.hasMove)
+        {
+            printf("%s: no move to make, result %d\n", board.name.c_str(), result.value > 0 ? 1 : -1);
+            continue;
+        }
+        printf("%s: Player A moves the piece at (%d, %d) to (%d, %d), result %d, %llu nodes, %.2f ms\n",
+               board.name.c_str(), result.best.fromRow, result.best.fromCol, result.best.toRow, result.best.toCol,
+               result.value, (unsigned long long)result.nodes, result.milliseconds);
+    }
+    printf("Solved %d boards in %.1f ms on %d threads (%.1f boards/sec).\n", (int)boards.size(), milliseconds, threads,
+           milliseconds > 0 ? 1000.0 * boards.size() / milliseconds : 0.0);
+
+    if (loaded != NULL)
+    {
+        TablebaseUnload(tablebase);
+    }
+    return 0;
+}
+
+bool SolveServerBoard(BatchBoard &board, const SolverOptions &options, ServerState &state, ServerWorker &worker)
+{
+    // Each worker keeps one table per board size for as long as the server is up
+    int rows = (int)board.lines.size();
+    int cols = (int)board.lines[0].size();
+#define SOLVE_BOARD(r, c) \
+    if (rows == r && cols == c) \
+    { \
+        TranspositionTable *&tt = worker.tables[r * 100 + c]; \
+        if (tt == NULL) \
+        { \
+            tt = new TranspositionTable(); \
+            TTInit(*tt, options.ttMegabytes > 0 ? options.ttMegabytes : SERVER_DEFAULT_MEGABYTES); \
+        } \
+        SolveBatchBoard<r, c>(board, options, state.tablebase, tt); \
+        return true; \
+    }
+    SUPPORTED_BOARDS(SOLVE_BOARD)
+#undef SOLVE_BOARD
+    return false;
+}
+
+bool ServeLines(FILE *in, FILE *out, const SolverOptions &options, ServerState &state, ServerWorker &worker)
+{
+    // One board per line with its rows separated by '/', for example
+    // BBB/BBB/XXX/XXX/WWW/WWW.  "quit" ends this client, "shutdown" the server.
+    char *buffer = NULL;
+    size_t capacity = 0;
+    bool shutdown = false;
+    while (!state.stopping && getline(&buffer, &capacity, in) >= 0)
+    {
+        std::string line = buffer;
+        while (!line.empty() && (line[line.size() - 1] == '\n' || line[line.size() - 1] == '\r' || line[line.size() - 1] == ' '))
+        {
+            line.erase(line.size() - 1);
+        }
+        if (line.empty())
+        {
+            continue;
+        }
+        if (line == "quit")
+        {
+            break;
+        }
+        if (line == "shutdown")
+        {
+            shutdown = true;
+            break;
+        }
+
+        BatchBoard board;
+        board.name = line;
+        board.result.solved = false;
+        size_t start = 0;
+        bool ragged = false;
+        while (start <= line.size())
+        {
+            size_t end = line.find('/', start);
+            if (end == std::string::npos)
+            {
+                end = line.size();
+            }
+            board.lines.push_back(line.substr(start, end - start));
+            ragged = ragged || board.lines.back().size() != board.lines[0].size();
+            start = end + 1;
+        }
+
+        const SolveResult &result = board.result;
+        if (ragged || board.lines[0].empty())
+        {
+            fprintf(out, "error: every row of %s has to be the same length\n", line.c_str());
+        }
+        else if (!SolveServerBoard(board, options, state, worker))
+        {
+            fprintf(out, "error: unsupported board size %d x %d\n", (int)board.lines.size(), (int)board.lines[0].size());
+        }
+        else if (!result.hasMove)
+        {
+            fprintf(out, "no move to make, result %d\n", result.value > 0 ? 1 : -1);
+        }
+        else
+        {
+            fprintf(out, "Player A moves the piece at (%d, %d) to (%d, %d), result %d, %llu nodes, %.2f ms, %llu of %llu table hits\n",
+                    result.best.fromRow, result.best.fromCol, result.best.toRow, result.best.toCol,
+                    result.value, (unsigned long long)result.nodes, result.milliseconds,
+                    (unsigned long long)result.tableHits, (unsigned long long)result.tableProbes);
+        }
+        fflush(out);
+    }
+    free(buffer);
+    return shutdown;
+}
+
+void ServeClient(int fd, const SolverOptions *options, ServerState *state)
+{
+    FILE *in = fdopen(fd, "r");
+    FILE *out = fdopen(dup(fd), "w");
+    if (in != NULL && out != NULL && ServeLines(in, out, *options, *state, state->workers[t_threadIndex]))
+    {
+        // Stop taking connections, and wake every client still waiting on a read
+        state->stopping = true;
+        shutdown(state->listenFd, SHUT_RDWR);
+        std::lock_guard<std::mutex> guard(state->clientsLock);
+        for (std::unordered_set<int>::iterator i = state->clients.begin(); i != state->clients.end(); ++i)
+        {
+            shutdown(*i, SHUT_RDWR);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(state->clientsLock);
+        state->clients.erase(fd);
+    }
+    if (out != NULL)
+    {
+        fclose(out);
+    }
+    if (in != NULL)
+    {
+        fclose(in);
+    }
+    else
+    {
+        close(fd);
+    }
+}
+
+int RunServer(const SolverOptions &options)
+{
+    // The process and its tables stay up between requests, so a board costs one
+    // search, against a table still holding everything solved before it
+    ServerState state;
+    state.stopping = false;
+    state.listenFd = -1;
+    state.tablebase = NULL;
+    signal(SIGPIPE, SIG_IGN); // A client that hangs up early is not our problem
+
+    Tablebase tablebase;
+    if (options.tablebaseFile != NULL)
+    {
+        if (TablebaseLoad(tablebase, options.tablebaseFile))
+        {
+            state.tablebase = &tablebase;
+        }
+        else
+        {
+            printf("Could not load the tablebase %s, searching without it.\n", options.tablebaseFile);
+        }
+    }
+
+    int result = 0;
+    if (options.socketPath == NULL)
+    {
+        state.workers.resize(1);
+        ServeLines(stdin, stdout, options, state, state.workers[0]);
+    }
+    else
+    {
+        // Connections are handed to the pool one task each, the thread that made
+        // the pool only accepts them
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, options.socketPath, sizeof(address.sun_path) - 1);
+        unlink(options.socketPath);
+        state.listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (state.listenFd < 0 || bind(state.listenFd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+            listen(state.listenFd, SERVER_BACKLOG) != 0)
+        {
+            printf("Could not listen on %s.\n", options.socketPath);
+            if (state.listenFd >= 0)
+            {
+                close(state.listenFd);
+            }
+            result = 1;
+        }
+        else
+        {
+            int threads = DefaultThreads(options);
+            state.workers.resize(threads + 1);
+            ThreadPool pool;
+            PoolInit(pool, threads + 1);
+            printf("Serving on %s with %d threads.\n", options.socketPath, threads);
+            fflush(stdout);
+
+            while (!state.stopping)
+            {
+                int fd = accept(state.listenFd, NULL, NULL);
+                if (fd < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    break; // Shut down by a client, or the socket is gone
+                }
+                {
+                    std::lock_guard<std::mutex> guard(state.clientsLock);
+                    state.clients.insert(fd);
+                }
+                const SolverOptions *serveOptions = &options;
+                ServerState *serveState = &state;
+                PoolSubmit(pool, [fd, serveOptions, serveState]() { ServeClient(fd, serveOptions, serveState); });
+            }
+
+            PoolShutdown(pool);
+            close(state.listenFd);
+            unlink(options.socketPath);
+        }
+    }
+
+    for (unsigned int i = 0; i < state.workers.size(); i++)
+    {
+        for (std::map<int, TranspositionTable *>::iterator t = state.workers[i].tables.begin(); t != state.workers[i].tables.end(); ++t)
+        {
+            delete t->second;
+        }
+    }
+    if (state.tablebase != NULL)
+    {
+        TablebaseUnload(tablebase);
+    }
+    return result;
+}
+
+template <int R, int C>
+void Board<R, C>::LoadDefaultBoard(Position &p)
+{
+    // Black fills rows 0 and 1, White fills rows 4 and 5
+    p.white = 0;
+    p.black = 0;
+    p.key = 0;
+    for (int i = 0; i < ROWS; i++)
+    {
         for (int j = 0; j < COLS; j++)
         {
-            std::cout << "[" << n->boardState[i][j] << "]";
+            if (i == 0 || i == 1)
+            {
+                SetSquare(p, i, j, 'B');
+            }
+            else if (i == ROWS - 2 || i == ROWS - 1)
+            {
+                SetSquare(p, i, j, 'W');
+            }
+        }
+    }
+}
+
+template <int R, int C>
+char Board<R, C>::GetSquare(const Position &p, int r, int c)
+{
+    Bitboard bit = (Bitboard)1 << (r * COLS + c);
+    if (p.white & bit)
+    {
+        return 'W';
+    }
+    else if (p.black & bit)
+    {
+        return 'B';
+    }
+    return 'X';
+}
+
+template <int R, int C>
+void Board<R, C>::SetSquare(Position &p, int r, int c, char piece)
+{
+    Bitboard bit = (Bitboard)1 << (r * COLS + c);
+
+    // Erase whatever was there first, anything other than W or B is an empty square
+    int square = r * COLS + c;
+    if (p.white & bit)
+    {
+        p.key ^= ZOBRIST_PIECES[0][square];
+    }
+    if (p.black & bit)
+    {
+        p.key ^= ZOBRIST_PIECES[1][square];
+    }
+    p.white &= ~bit;
+    p.black &= ~bit;
+
+    if (piece == 'W')
+    {
+        p.white |= bit;
+        p.key ^= ZOBRIST_PIECES[0][square];
+    }
+    else if (piece == 'B')
+    {
+        p.black |= bit;
+        p.key ^= ZOBRIST_PIECES[1][square];
+    }
+
+    UpdateStatus(p);
+}
+
+template <int R, int C>
+Point Board<R, C>::SquareToPoint(int square)
+{
+    return Point(square / COLS, square % COLS);
+}
+
+template <int R, int C>
+int Board<R, C>::PointToSquare(Point p)
+{
+    return p.r * COLS + p.c;
+}
+
+template <int R, int C>
+int Board<R, C>::MirrorSquare(int square)
+{
+    return square + COLS - 1 - 2 * (square % COLS);
+}
+
+template <int R, int C>
+Bitboard Board<R, C>::MirrorBits(Bitboard b)
+{
+    // Swap columns c and COLS - 1 - c, every row at once.  The middle column of
+    // an odd width board stays where it is.
+    Bitboard mirrored = (COLS % 2 == 1) ? (b & (FIRST_COLUMN << (COLS / 2))) : 0;
+    for (int c = 0; c < COLS / 2; c++)
+    {
+        int shift = COLS - 1 - 2 * c;
+        mirrored |= (b & (FIRST_COLUMN << c)) << shift;
+        mirrored |= (b & (LAST_COLUMN >> c)) >> shift;
+    }
+    return mirrored;
+}
+
+template <int R, int C>
+uint64_t Board<R, C>::CanonicalKey(const Position &p, bool &mirrored)
+{
+    // The rules do not care which way round the columns are, so a position and its
+    // mirror have the same value and mirrored best moves.  Whichever of the two has
+    // the smaller bitboards is the canonical one, and only that key is ever stored.
+    Bitboard white = MirrorBits(p.white);
+    Bitboard black = MirrorBits(p.black);
+    mirrored = white < p.white || (white == p.white && black < p.black);
+    if (!mirrored)
+    {
+        return PositionKey(p);
+    }
+
+    uint64_t key = p.isWhitePlayer ? 0 : ZOBRIST_BLACK_TO_MOVE;
+    for (; white; white &= white - 1)
+    {
+        key ^= ZOBRIST_PIECES[0][__builtin_ctzll(white)];
+    }
+    for (; black; black &= black - 1)
+    {
+        key ^= ZOBRIST_PIECES[1][__builtin_ctzll(black)];
+    }
+    return key;
+}
+
+template <int R, int C>
+void Board<R, C>::UpdateStatus(Position &p)
+{
+    // Only for positions put together square by square, MakeMove keeps these
+    // up to date as it goes
+    p.whiteCount = __builtin_popcountll(p.white);
+    p.blackCount = __builtin_popcountll(p.black);
+    p.winner = 0;
+
+    // Capture win checks
+    if (p.blackCount == 0) // If all Black Pieces captured, White win
+    {
+        p.winner = 1;
+    }
+    else if (p.whiteCount == 0) // If all White Pieces captured, Black win
+    {
+        p.winner = -1;
+    }
+    // Goal Zone Win Checks
+    else if (p.white & TOP_ROW) // If White piece is at top
+    {
+        p.winner = 1;
+    }
+    else if (p.black & BOTTOM_ROW) // If Black piece is at bottom
+    {
+        p.winner = -1;
+    }
+}
+
+template <int R, int C>
+int Board<R, C>::CheckWinCondition(const Position &p)
+{
+    // Worked out when the position was made, see UpdateStatus and MakeMove
+    return p.winner;
+}
+
+template <int R, int C>
+int Board<R, C>::CheckNumberOfPieces(const Position &p, char c)
+{
+    if (c == 'W')
+    {
+        return p.whiteCount;
+    }
+    else if (c == 'B')
+    {
+        return p.blackCount;
+    }
+    return __builtin_popcountll(ALL_SQUARES & ~(p.white | p.black));
+}
+
+template <int R, int C>
+int Board<R, C>::GenerateMoves(const Position &p, Move *moves)
+{
+    // Every piece looks its three steps up in MoveTables and masks them against the
+    // board: the forward step needs an empty square, the diagonals anything but our
+    // own piece.  Steps off the board are 0 in the table, so there are no bounds to
+    // check.  Pieces are walked in the same order the old board scan used so the
+    // search and its printouts stay identical: White goes top left to bottom right,
+    // Black goes bottom right to top left.
+    Bitboard empty = ALL_SQUARES & ~(p.white | p.black);
+    int numMoves = 0;
+
+    if (p.isWhitePlayer) // White pieces move up (towards bit 0)
+    {
+        const Bitboard (&steps)[3][SQUARES] = MoveTables<R, C>::STEPS[0];
+        Bitboard winning = TOP_ROW | (p.blackCount == 1 ? p.black : 0); // Goal row, or the last Black piece
+        Bitboard notOwn = ALL_SQUARES & ~p.white; // Cannot capture yourself
+        for (Bitboard pieces = p.white; pieces; pieces &= pieces - 1)
+        {
+            int from = __builtin_ctzll(pieces);
+            AddMove(moves, numMoves, from, steps[0][from] & notOwn, winning);
+            AddMove(moves, numMoves, from, steps[1][from] & empty, winning);
+            AddMove(moves, numMoves, from, steps[2][from] & notOwn, winning);
+        }
+    }
+    else // Black pieces move down
+    {
+        const Bitboard (&steps)[3][SQUARES] = MoveTables<R, C>::STEPS[1];
+        Bitboard winning = BOTTOM_ROW | (p.whiteCount == 1 ? p.white : 0); // Goal row, or the last White piece
+        Bitboard notOwn = ALL_SQUARES & ~p.black; // Cannot capture yourself
+        for (Bitboard pieces = p.black; pieces; )
+        {
+            int from = 63 - __builtin_clzll(pieces);
+            pieces &= ~((Bitboard)1 << from);
+            AddMove(moves, numMoves, from, steps[0][from] & notOwn, winning);
+            AddMove(moves, numMoves, from, steps[1][from] & empty, winning);
+            AddMove(moves, numMoves, from, steps[2][from] & notOwn, winning);
+        }
+    }
+
+    return numMoves;
+}
+
+template <int R, int C>
+int Board<R, C>::Evaluate(const Position &p)
+{
+    // Material comes first, then how far each side's pawns have come, then the race
+    // between the two most advanced pawns (the side to move is a tempo ahead)
+    int score = 100 * (p.whiteCount - p.blackCount);
+    for (int r = 0; r < ROWS; r++)
+    {
+        Bitboard row = TOP_ROW << (r * COLS);
+        score += 10 * ((ROWS - 1 - r) * __builtin_popcountll(p.white & row) - r * __builtin_popcountll(p.black & row));
+    }
+
+    if (p.white && p.black)
+    {
+        int whiteDistance = (__builtin_ctzll(p.white) / COLS) - (p.isWhitePlayer ? 1 : 0);
+        int blackDistance = (ROWS - 1 - (63 - __builtin_clzll(p.black)) / COLS) - (p.isWhitePlayer ? 0 : 1);
+        score += 50 * (blackDistance - whiteDistance);
+    }
+
+    return std::max(-WIN_SCORE + 1, std::min(WIN_SCORE - 1, score));
+}
+
+template <int R, int C>
+int Board<R, C>::RaceWinner(const Position &p)
+{
+    // The side to move wins if one of its pawns has nothing of its own on the way to
+    // the goal row, no enemy pawn in its race cone, and is no further from the goal
+    // than the enemy's most advanced pawn is from its own.  Pushing that pawn every
+    // move wins: nothing can block or take it, and it arrives first because the side
+    // to move is a tempo ahead.  Only ever says a position is won when it is, and
+    // says nothing (0) about the rest.
+    if (p.white == 0 || p.black == 0)
+    {
+        return 0;
+    }
+    int color = p.isWhitePlayer ? 0 : 1;
+    Bitboard own = p.isWhitePlayer ? p.white : p.black;
+    Bitboard enemy = p.isWhitePlayer ? p.black : p.white;
+    int enemyDistance = p.isWhitePlayer ? ROWS - 1 - (63 - __builtin_clzll(p.black)) / COLS : __builtin_ctzll(p.white) / COLS;
+    for (Bitboard pieces = own; pieces; pieces &= pieces - 1)
+    {
+        int square = __builtin_ctzll(pieces);
+        int distance = p.isWhitePlayer ? square / COLS : ROWS - 1 - square / COLS;
+        Bitboard cone = RaceTables<R, C>::CONES[color][square];
+        if (distance <= enemyDistance && (cone & enemy) == 0 && (cone & own & (FIRST_COLUMN << (square % COLS))) == 0)
+        {
+            return p.isWhitePlayer ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+void AddMove(Move *moves, int &numMoves, int from, Bitboard target, Bitboard winning)
+{
+    // Always written, only kept if there was a target.  The top bit stands in for an
+    // empty target so the bit scan is defined, and it is never counted.
+    moves[numMoves].from = from;
+    moves[numMoves].to = __builtin_ctzll(target | ((Bitboard)1 << 63));
+    moves[numMoves].wins = (winning & target) != 0;
+    numMoves += target != 0;
+}
+
+Position ApplyMove(const Position &p, Move m)
+{
+    Position child = p;
+    Undo undo;
+    MakeMove(child, m, undo);
+    return child;
+}
+
+void MakeMove(Position &p, Move m, Undo &undo)
+{
+    Bitboard fromBit = (Bitboard)1 << m.from;
+    Bitboard toBit = (Bitboard)1 << m.to;
+
+    undo.key = p.key;
+    undo.winner = p.winner;
+    if (p.isWhitePlayer)
+    {
+        undo.captured = p.black & toBit; // Captures just clear the enemy bit
+        p.white = (p.white & ~fromBit) | toBit;
+        p.black &= ~toBit;
+        p.key ^= ZOBRIST_PIECES[0][m.from] ^ ZOBRIST_PIECES[0][m.to];
+        if (undo.captured)
+        {
+            p.key ^= ZOBRIST_PIECES[1][m.to];
+            p.blackCount--;
+        }
+    }
+    else
+    {
+        undo.captured = p.white & toBit;
+        p.black = (p.black & ~fromBit) | toBit;
+        p.white &= ~toBit;
+        p.key ^= ZOBRIST_PIECES[1][m.from] ^ ZOBRIST_PIECES[1][m.to];
+        if (undo.captured)
+        {
+            p.key ^= ZOBRIST_PIECES[0][m.to];
+            p.whiteCount--;
+        }
+    }
+
+    // A move can only win the game for the side making it, and GenerateMoves already knows if it does
+    if (m.wins)
+    {
+        p.winner = p.isWhitePlayer ? 1 : -1;
+    }
+    p.isWhitePlayer = !p.isWhitePlayer;
+}
+
+void UnmakeMove(Position &p, Move m, const Undo &undo)
+{
+    Bitboard fromBit = (Bitboard)1 << m.from;
+    Bitboard toBit = (Bitboard)1 << m.to;
+
+    p.isWhitePlayer = !p.isWhitePlayer;
+    if (p.isWhitePlayer)
+    {
+        p.white = (p.white & ~toBit) | fromBit;
+        p.black |= undo.captured;
+        p.blackCount += undo.captured != 0;
+    }
+    else
+    {
+        p.black = (p.black & ~toBit) | fromBit;
+        p.white |= undo.captured;
+        p.whiteCount += undo.captured != 0;
+    }
+    p.key = undo.key;
+    p.winner = undo.winner;
+}
+
+void MoveToFront(Move *moves, int numMoves, int from, int to)
+{
+    for (int i = 1; i < numMoves; i++)
+    {
+        if (moves[i].from == from && moves[i].to == to)
+        {
+            // Shift the earlier moves down one so the rest keep their order
+            Move best = moves[i];
+            for (int j = i; j > 0; j--)
+            {
+                moves[j] = moves[j - 1];
+            }
+            moves[0] = best;
+            return;
+        }
+    }
+}
+
+void OrderingInit(MoveOrdering &ordering, OrderPolicy policy)
+{
+    ordering.policy = policy;
+    for (int ply = 0; ply < MAX_PLY; ply++)
+    {
+        for (int k = 0; k < 2; k++)
+        {
+            ordering.killers[ply][k].from = -1;
+            ordering.killers[ply][k].to = -1;
+        }
+    }
+    memset(ordering.history, 0, sizeof(ordering.history));
+    ordering.nodes = 0;
+}
+
+MoveOrdering *OrderingCreate(OrderPolicy policy)
+{
+    MoveOrdering *ordering = new MoveOrdering();
+    OrderingInit(*ordering, policy);
+    return ordering;
+}
+
+SearchOptions SolverSearchOptions(const SolverOptions &options)
+{
+    SearchOptions searchOptions;
+    searchOptions.ttMegabytes = options.ttMegabytes;
+    searchOptions.mirror = options.mirror;
+    searchOptions.order = options.order;
+    searchOptions.race = options.race;
+    return searchOptions;
+}
+
+void SearchContextInit(SearchContext &context, const SearchOptions &options, TranspositionTable *tt, MoveOrdering *ordering)
+{
+    // Callers attach the rest (arena, tablebase, trace, cache, scouts) afterwards
+    context.tt = tt;
+    context.arena = NULL;
+    context.releaseSubtrees = true;
+    context.ordering = ordering;
+    context.tablebase = NULL;
+    context.trace = NULL;
+    context.mirror = options.mirror;
+    context.cache = NULL;
+    context.scout = false;
+    context.race = options.race;
+}
+
+int DefaultThreads(const SolverOptions &options)
+{
+    return options.threads > 0 ? options.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+}
+
+template <int R, int C>
+void OrderMoves(const Position &p, Move *moves, int numMoves, int ply, const MoveOrdering *ordering)
+{
+    // Score every move, then insertion sort on the scores.  The sort is stable, so
+    // moves with the same score stay in generation order and ORDER_NONE changes nothing.
+    if (ordering->policy == ORDER_NONE)
+    {
+        return;
+    }
+
+    Bitboard enemy = p.isWhitePlayer ? p.black : p.white;
+    uint32_t scores[Board<R, C>::MAX_MOVES];
+    for (int i = 0; i < numMoves; i++)
+    {
+        Bitboard toBit = (Bitboard)1 << moves[i].to;
+        uint32_t score = 0;
+        if (moves[i].wins)
+        {
+            score = 0xF0000000; // Reaches the goal row or takes the last enemy piece
+        }
+        else if (toBit & enemy)
+        {
+            score = 0xE0000000;
+        }
+        else if (ordering->policy >= ORDER_KILLERS &&
+                 moves[i].from == ordering->killers[ply][0].from && moves[i].to == ordering->killers[ply][0].to)
+        {
+            score = 0xD0000000;
+        }
+        else if (ordering->policy >= ORDER_KILLERS &&
+                 moves[i].from == ordering->killers[ply][1].from && moves[i].to == ordering->killers[ply][1].to)
+        {
+            score = 0xC0000000;
+        }
+        else if (ordering->policy >= ORDER_HISTORY)
+        {
+            score = std::min(ordering->history[moves[i].from][moves[i].to], (uint32_t)0xBFFFFFFF);
         }
-        std::cout << std::endl;
+        scores[i] = score;
     }
 
-    return;
+    for (int i = 1; i < numMoves; i++)
+    {
+        Move move = moves[i];
+        uint32_t score = scores[i];
+        int j = i;
+        while (j > 0 && scores[j - 1] < score)
+        {
+            moves[j] = moves[j - 1];
+            scores[j] = scores[j - 1];
+            j--;
+        }
+        moves[j] = move;
+        scores[j] = score;
+    }
 }
 
-bool LoadFile(Node *n)
+void RecordCutoff(MoveOrdering *ordering, const Position &p, Move m, int ply, int weight)
 {
-    std::ifstream file("input.txt");
-
-    bool fullyLoaded = false;
+    // Captures are already near the front, only quiet moves are worth remembering
+    Bitboard enemy = p.isWhitePlayer ? p.black : p.white;
+    if (enemy & ((Bitboard)1 << m.to))
+    {
+        return;
+    }
 
-    if (file.is_open())
+    Move *killers = ordering->killers[ply];
+    if (killers[0].from != m.from || killers[0].to != m.to)
     {
-        for (int i = 0; i < ROWS; i++)
-        {
-            std::string line = "";
-            getline(file, line);
-            for (int j = 0; j < COLS; j++)
-            {
-                n->boardState[i][j] = line[j];
-            }
-        }
-        fullyLoaded = true;
+        killers[1] = killers[0];
+        killers[0] = m;
     }
-    else
+
+    uint32_t &history = ordering->history[m.from][m.to];
+    history = std::min(history + (uint32_t)weight, (uint32_t)0xBFFFFFFF);
+}
+
+uint64_t SplitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void InitZobristKeys()
+{
+    // splitmix64 with a fixed seed, so keys are the same on every run
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (int color = 0; color < 2; color++)
     {
-        std::cout << "NO FILE FOUND, LOADING IN DEFAULT CONFIGURATION!" << std::endl;
-        for (int i = 0; i < ROWS; i++)
+        for (int sq = 0; sq < MAX_SQUARES; sq++)
         {
-            for (int j = 0; j < COLS; j++)
-            {
-                if (i == 0 || i == 1)
-                {
-                    n->boardState[i][j] = 'B';
-                }
-                else if (i == 4 || i == 5)
-                {
-                    n->boardState[i][j] = 'W';
-                }
-                else
-                {
-                    n->boardState[i][j] = 'X';
-                }
-            }
+            ZOBRIST_PIECES[color][sq] = SplitMix64(seed);
         }
-        fullyLoaded = true;
     }
+    ZOBRIST_BLACK_TO_MOVE = SplitMix64(seed);
+}
 
-    file.close();
+uint64_t PositionKey(const Position &p)
+{
+    // The side to move is left out of p.key so isWhitePlayer can be flipped directly
+    return p.isWhitePlayer ? p.key : (p.key ^ ZOBRIST_BLACK_TO_MOVE);
+}
 
-    return fullyLoaded;
+template <int R, int C>
+uint64_t TableKey(const Position &p, bool mirror, bool &mirrored)
+{
+    mirrored = false;
+    return mirror ? Board<R, C>::CanonicalKey(p, mirrored) : PositionKey(p);
 }
 
-bool LoadFileCustom(Node *n, std::string fileName)
+void TTInit(TranspositionTable &tt, int megabytes)
 {
-    std::ifstream file(fileName.c_str());
+    uint64_t maxEntries = ((uint64_t)megabytes * 1024 * 1024) / sizeof(TTEntry);
+    uint64_t size = 1;
+    while (size * 2 <= maxEntries)
+    {
+        size *= 2;
+    }
 
-    bool fullyLoaded = false;
+    TTEntry empty;
+    empty.key = 0;
+    empty.value = 0;
+    empty.depth = 0;
+    empty.flag = TT_EXACT;
+    empty.bestFrom = -1;
+    empty.bestTo = -1;
+
+    tt.entries.assign(size, empty);
+    tt.mask = size - 1;
+    tt.probes = 0;
+    tt.hits = 0;
+    tt.stores = 0;
+}
 
-    if (file.is_open())
+void ProofTableInit(ProofTable &table, int megabytes)
+{
+    uint64_t maxBuckets = ((uint64_t)megabytes * 1024 * 1024) / (sizeof(ProofEntry) * PN_BUCKET);
+    uint64_t buckets = 1;
+    while (buckets * 2 <= maxBuckets)
+    {
+        buckets *= 2;
+    }
+
+    ProofEntry empty;
+    empty.key = 0;
+    empty.pn = 1;
+    empty.dn = 1;
+    empty.work = 0;
+
+    table.entries.assign(buckets * PN_BUCKET, empty);
+    table.mask = buckets - 1;
+    table.stores = 0;
+}
+
+bool ProofTableProbe(const ProofTable &table, uint64_t key, uint32_t &pn, uint32_t &dn)
+{
+    const ProofEntry *bucket = &table.entries[(key & table.mask) * PN_BUCKET];
+    for (int i = 0; i < PN_BUCKET; i++)
     {
-        for (int i = 0; i < ROWS; i++)
+        if (bucket[i].key == key)
         {
-            std::string line = "";
-            getline(file, line);
-            for (int j = 0; j < COLS; j++)
-            {
-                n->boardState[i][j] = line[j];
-            }
+            pn = bucket[i].pn;
+            dn = bucket[i].dn;
+            return true;
         }
-        fullyLoaded = true;
     }
-    else
+    return false;
+}
+
+void ProofTableStore(ProofTable &table, uint64_t key, uint32_t pn, uint32_t dn, uint64_t work)
+{
+    // Keep the entries that took the most work to get, they are the most expensive to redo
+    ProofEntry *bucket = &table.entries[(key & table.mask) * PN_BUCKET];
+    ProofEntry *slot = &bucket[0];
+    for (int i = 0; i < PN_BUCKET; i++)
     {
-        std::cout << "NO FILE FOUND, LOADING IN DEFAULT CONFIGURATION!" << std::endl;
-        for (int i = 0; i < ROWS; i++)
+        if (bucket[i].key == key)
         {
-            for (int j = 0; j < COLS; j++)
-            {
-                if (i == 0 || i == 1)
-                {
-                    n->boardState[i][j] = 'B';
-                }
-                else if (i == 4 || i == 5)
-                {
-                    n->boardState[i][j] = 'W';
-                }
-                else
-                {
-                    n->boardState[i][j] = 'X';
-                }
-            }
+            slot = &bucket[i];
+            break;
+        }
+        if (bucket[i].work < slot->work)
+        {
+            slot = &bucket[i];
         }
-        fullyLoaded = true;
     }
+    slot->key = key;
+    slot->pn = pn;
+    slot->dn = dn;
+    slot->work = (uint32_t)std::min(work, (uint64_t)0xFFFFFFFF);
+    table.stores++;
+}
 
-    file.close();
-
-    return fullyLoaded;
+bool TTProbe(TranspositionTable &tt, uint64_t key, TTEntry &entry)
+{
+    tt.probes++;
+    const TTEntry &slot = tt.entries[key & tt.mask];
+    if (slot.key != key)
+    {
+        return false;
+    }
+    tt.hits++;
+    entry = slot;
+    return true;
 }
 
-int CheckWinCondition(Node *n)
+bool TTCutoff(const TTEntry &entry, int a, int b)
 {
+    return entry.flag == TT_EXACT ||
+           (entry.flag == TT_LOWER && entry.value >= b) ||
+           (entry.flag == TT_UPPER && entry.value <= a);
+}
 
-    // Capture win checks
-    if (CheckNumberOfPieces(n, 'B') == 0) // If all Black Pieces captured, White win
+TTFlag BoundFlag(int value, int alphaOrig, int betaOrig)
+{
+    if (value <= alphaOrig)
     {
-        return 1;
+        return TT_UPPER;
     }
+    else if (value >= betaOrig)
+    {
+        return TT_LOWER;
+    }
+    return TT_EXACT;
+}
+
+void TTStore(TranspositionTable &tt, uint64_t key, int value, int depth, TTFlag flag, int bestFrom, int bestTo)
+{
+    TTEntry &slot = tt.entries[key & tt.mask];
+    slot.key = key;
+    slot.value = value;
+    slot.depth = depth;
+    slot.flag = flag;
+    slot.bestFrom = bestFrom;
+    slot.bestTo = bestTo;
+    tt.stores++;
+}
 
-    if (CheckNumberOfPieces(n, 'W') == 0) // If all White Pieces captured, Black win
+void SharedInit(SharedTable &table, int megabytes, int threads, bool mirror)
+{
+    uint64_t maxBuckets = ((uint64_t)megabytes * 1024 * 1024) / (sizeof(SharedEntry) * SHARED_BUCKET);
+    uint64_t size = 1;
+    while (size * 2 <= maxBuckets)
     {
-        return -1;
+        size *= 2;
     }
 
-    // Goal Zone Win Checks
-    for (int i = 0; i < COLS; i++)
+    SharedEntry empty;
+    empty.check = 0;
+    empty.data = 0;
+    table.entries.assign(size * SHARED_BUCKET, empty);
+    table.mask = size - 1;
+    table.generation = 0;
+    table.mirror = mirror;
+    SharedCounters zero;
+    memset(&zero, 0, sizeof(zero));
+    table.counters.assign(std::max(1, threads), zero);
+}
+
+void SharedNewSearch(SharedTable &table)
+{
+    table.generation++;
+}
+
+bool SharedProbe(SharedTable &table, uint64_t key, TTEntry &entry)
+{
+    // Only writes the entry on a hit
+    SharedCounters &counters = table.counters[t_threadIndex % table.counters.size()];
+    counters.probes++;
+    const SharedEntry *bucket = &table.entries[(key & table.mask) * SHARED_BUCKET];
+    for (int i = 0; i < SHARED_BUCKET; i++)
     {
-        if (n->boardState[0][i] == 'W') // If White piece is at top
+        uint64_t data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&bucket[i].check, __ATOMIC_RELAXED);
+        if ((check ^ data) != key || data == 0)
         {
-            return 1;
+            if (data != 0 && ((check ^ data) & table.mask) != (key & table.mask))
+            {
+                counters.torn++; // No key that belongs in this bucket: check and data are from different writes
+            }
+            continue;
         }
+        counters.hits++;
+        entry.key = key;
+        entry.value = (int16_t)(data & 0xFFFF);
+        entry.depth = (int16_t)((data >> 16) & 0xFF);
+        entry.flag = (uint8_t)((data >> 24) & 0xFF);
+        entry.bestFrom = (int8_t)((data >> 40) & 0xFF);
+        entry.bestTo = (int8_t)((data >> 48) & 0xFF);
+        return true;
     }
+    return false;
+}
 
-    for (int i = 0; i < COLS; i++)
+void SharedStore(SharedTable &table, uint64_t key, int value, int depth, TTFlag flag, int bestFrom, int bestTo)
+{
+    // The same position is always written over.  Otherwise an empty entry goes
+    // first, then one from an older search, then the shallowest.  Two threads can
+    // pick the same entry at once: whichever writes last wins it, and a reader in
+    // between sees the check fail.
+    SharedCounters &counters = table.counters[t_threadIndex % table.counters.size()];
+    SharedEntry *bucket = &table.entries[(key & table.mask) * SHARED_BUCKET];
+    SharedEntry *slot = NULL;
+    int slotAge = 0;
+    int slotDepth = 0;
+    bool slotUsed = false;
+    for (int i = 0; i < SHARED_BUCKET; i++)
     {
-        if (n->boardState[5][i] == 'B') // If Black piece is at bottom
+        uint64_t data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&bucket[i].check, __ATOMIC_RELAXED);
+        if ((check ^ data) == key && data != 0)
+        {
+            slot = &bucket[i];
+            slotUsed = false;
+            break;
+        }
+        int age = (uint8_t)(table.generation - (uint8_t)(data >> 32));
+        int oldDepth = (int)((data >> 16) & 0xFF);
+        if (data == 0)
+        {
+            age = 0x100; // Empty, use it before anything
+        }
+        if (slot == NULL || age > slotAge || (age == slotAge && oldDepth < slotDepth))
         {
-            return -1;
+            slot = &bucket[i];
+            slotAge = age;
+            slotDepth = oldDepth;
+            slotUsed = data != 0;
         }
     }
 
-    return 0;
+    uint64_t data = (uint64_t)(uint16_t)(int16_t)value | ((uint64_t)std::min(std::max(depth, 0), 0xFF) << 16) |
+                    ((uint64_t)(uint8_t)flag << 24) | ((uint64_t)table.generation << 32) |
+                    ((uint64_t)(uint8_t)(int8_t)bestFrom << 40) | ((uint64_t)(uint8_t)(int8_t)bestTo << 48);
+    __atomic_store_n(&slot->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->check, key ^ data, __ATOMIC_RELAXED);
+    counters.stores++;
+    if (slotUsed)
+    {
+        counters.replaced++;
+    }
 }
 
-int CheckNumberOfPieces(Node *n, char c)
+SharedCounters SharedTotals(const SharedTable &table)
 {
-    int numChars = 0;
-    for (int i = 0; i < ROWS; i++)
+    SharedCounters totals;
+    memset(&totals, 0, sizeof(totals));
+    for (unsigned int i = 0; i < table.counters.size(); i++)
     {
-        for (int j = 0; j < COLS; j++)
-        {
-            if (n->boardState[i][j] == c) // If character found, increment
-            {
-                numChars++;
-            }
-        }
+        totals.probes += table.counters[i].probes;
+        totals.hits += table.counters[i].hits;
+        totals.stores += table.counters[i].stores;
+        totals.replaced += table.counters[i].replaced;
+        totals.torn += table.counters[i].torn;
     }
-    return numChars;
+    return totals;
 }
 
-void FindAndMovePieces(Node *n) // Look for white or black pieces
+void SharedBenchmark(int megabytes, int maxThreads)
 {
-    if (!n->isWhitePlayer) // Iterate from bottom right to top left
+    // Every thread looks up keys drawn from the same set of positions and stores
+    // the ones it misses, the way the parallel search uses the table, but with no
+    // search in between, so the table is all that is being timed
+    std::vector<uint64_t> keys(SHARED_BENCH_KEYS);
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    for (unsigned int i = 0; i < keys.size(); i++)
+    {
+        keys[i] = std::max(SplitMix64(seed), (uint64_t)1); // 0 is never a key
+    }
+
+    printf("Shared table of %d MB, %d positions, %llu lookups per run\n", megabytes, SHARED_BENCH_KEYS,
+           (unsigned long long)SHARED_BENCH_OPS);
+    printf("Threads    Probes/sec    Speedup    Hit rate    Replaced    Torn\n");
+    double baseRate = 0.0;
+    for (int threads = 1; ; threads *= 2)
     {
-        for (int i = ROWS - 1; i >= 0; i--)
+        threads = std::min(threads, maxThreads);
+
+        SharedTable *table = new SharedTable();
+        SharedInit(*table, megabytes, threads, false); // Made up keys, there is no position to mirror
+        SharedNewSearch(*table);
+        ThreadPool pool;
+        PoolInit(pool, threads);
+        const uint64_t *keyList = &keys[0];
+        SharedTable *shared = table;
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        PoolParallelFor(pool, SHARED_BENCH_OPS, [keyList, shared](uint64_t first, uint64_t end)
         {
-            for (int j = COLS - 1; j >= 0 ; j--)
+            TTEntry entry;
+            for (uint64_t i = first; i < end; i++)
             {
-                Point p(i, j); // Starting point to pass into CreateChildren(...)
-                if (n->boardState[i][j] == 'B')
+                // A multiplicative hash of i picks the key, so every chunk wanders over all of them
+                uint64_t key = keyList[(i * 0x9E3779B97F4A7C15ULL >> 40) % SHARED_BENCH_KEYS];
+                if (!SharedProbe(*shared, key, entry))
                 {
-                    CreateChildren(n, p);
+                    SharedStore(*shared, key, (key & 1) ? 1 : -1, (int)(key >> 58), TT_EXACT, -1, -1);
                 }
             }
+        });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        PoolShutdown(pool);
+
+        SharedCounters totals = SharedTotals(*table);
+        double rate = seconds > 0.0 ? totals.probes / seconds : 0.0;
+        if (threads == 1)
+        {
+            baseRate = rate;
+        }
+        printf("%7d    %10.3gM    %6.2fx    %7.1f%%    %8llu    %4llu\n", threads, rate / 1e6,
+               baseRate > 0.0 ? rate / baseRate : 0.0, totals.probes > 0 ? 100.0 * totals.hits / totals.probes : 0.0,
+               (unsigned long long)totals.replaced, (unsigned long long)totals.torn);
+        delete table;
+
+        if (threads >= maxThreads)
+        {
+            break;
         }
     }
-    else // Iterate from top left to bottom
+}
+
+template <int R, int C>
+void MoveChildToFront(Node *n, int from, int to)
+{
+    for (unsigned int i = 1; i < n->children.size(); i++)
     {
-        for (int i = 0; i < ROWS; i++)
+        Node *child = n->children[i];
+        if (Board<R, C>::PointToSquare(child->movedFrom) == from && Board<R, C>::PointToSquare(child->movedTo) == to)
         {
-            for (int j = 0; j < COLS; j++)
+            // Shift the earlier children down one so the rest keep their order
+            for (unsigned int j = i; j > 0; j--)
             {
-                Point p(i, j); // Starting point to pass into CreateChildren(...)
-                if (n->boardState[i][j] == 'W')
-                {
-                    CreateChildren(n, p);
-                }
+                n->children[j] = n->children[j - 1];
             }
+            n->children[0] = child;
+            return;
         }
     }
+}
 
-
-    return;
+template <int R, int C>
+void FindAndMovePieces(Node *n) // Look for white or black pieces
+{
+    FindAndMovePieces<R, C>(n, NULL);
 }
 
-void CreateChildren(Node *n, Point p)
+template <int R, int C>
+void FindAndMovePieces(Node *n, NodeArena *arena)
 {
-    // Try to create left diagonal move
-    Point p_dl = CreateDiagonalPoint(n, p, true);
-    if (!(p_dl.r == -1 && p_dl.c == -1))
+    Move moves[Board<R, C>::MAX_MOVES];
+    int numMoves = Board<R, C>::GenerateMoves(n->position, moves);
+
+    // All of the moves are known up front, so the child list is sized exactly once
+    size_t bytes = numMoves * sizeof(Node *);
+    if (arena != NULL)
     {
-        CreateChild(n, p, p_dl);
+        n->children.items = (Node **)ArenaAlloc(*arena, bytes);
     }
-
-    // Try to create forward move
-    Point p_f = CreateForwardPoint(n, p);
-    if (!(p_f.r == -1 && p_f.c == -1))
+    else
     {
-        CreateChild(n, p, p_f);
+        n->children.items = new Node *[numMoves];
+        g_heapStats.allocations++;
+        g_heapStats.bytesInUse += bytes;
+        g_heapStats.peakBytes = g_heapStats.bytesInUse; // Nothing made with new is ever freed
     }
+    n->children.count = 0;
 
-    // Try to create right diagonal move
-    Point p_dr = CreateDiagonalPoint(n, p, false);
-    if (!(p_dr.r == -1 && p_dr.c == -1))
+    for (int i = 0; i < numMoves; i++)
     {
-        CreateChild(n, p, p_dr);
+        CreateChild<R, C>(n, moves[i], arena);
     }
 
     return;
 }
 
-void CreateChild(Node *n, Point startPt, Point endPt)
+template <int R, int C>
+void CreateChild(Node *n, Move m, NodeArena *arena)
 {
-    Node *newNode = new Node();
-
-    newNode->movedFrom = startPt;
-    newNode->movedTo = endPt;
-    newNode->isWhitePlayer = !n->isWhitePlayer;
-    newNode->whiteWinNode = NULL;
-
-    // Set the new board state to the old board state
-    for (int i = 0; i < ROWS; i++)
-    {
-        for (int j = 0; j < COLS; j++)
-        {
-            newNode->boardState[i][j] = n->boardState[i][j];
-        }
-    }
-
-    // Now do modify the new board state in newNode
-
-    // Set New Position
-    if (n->isWhitePlayer)
+    Node *newNode;
+    if (arena != NULL)
     {
-        newNode->boardState[endPt.r][endPt.c] = 'W';
+        newNode = new (ArenaAlloc(*arena, sizeof(Node))) Node();
+        arena->stats.nodes++;
     }
     else
     {
-        newNode->boardState[endPt.r][endPt.c] = 'B';
+        newNode = new Node();
+        g_heapStats.allocations++;
+        g_heapStats.nodes++;
+        g_heapStats.bytesInUse += sizeof(Node);
+        g_heapStats.peakBytes = g_heapStats.bytesInUse;
     }
 
-    // Erase Old Position
-    newNode->boardState[startPt.r][startPt.c] = 'X';
+    newNode->movedFrom = Board<R, C>::SquareToPoint(m.from);
+    newNode->movedTo = Board<R, C>::SquareToPoint(m.to);
+    newNode->whiteWinNode = NULL;
+    newNode->children.clear();
+    newNode->position = ApplyMove(n->position, m);
 
     // Push this child into n
-    n->children.push_back(newNode);
+    n->children.items[n->children.count++] = newNode;
     return;
 }
 
-Point CreateForwardPoint(Node *n, Point p)
+void ArenaInit(NodeArena &arena, size_t blockSize)
+{
+    arena.blocks.clear();
+    arena.blockSizes.clear();
+    arena.blockSize = blockSize;
+    arena.current = 0;
+    arena.used = 0;
+    memset(&arena.stats, 0, sizeof(arena.stats));
+}
+
+void *ArenaAlloc(NodeArena &arena, size_t bytes)
 {
-    if (n->isWhitePlayer) // White pieces move up
+    bytes = (bytes + 15) & ~(size_t)15; // Keep everything 16 byte aligned
+
+    if (arena.blocks.empty() || arena.used + bytes > arena.blockSizes[arena.current])
     {
-        if (n->boardState[p.r - 1][p.c] == 'X')
-        {
-            return Point(p.r - 1, p.c);
-        }
-        else
+        // Move on to the next block, reusing one from before a release if it is big enough
+        size_t next = arena.blocks.empty() ? 0 : arena.current + 1;
+        if (next >= arena.blocks.size() || arena.blockSizes[next] < bytes)
         {
-            return Point(-1, -1);
+            size_t size = std::max(arena.blockSize, bytes);
+            arena.blocks.insert(arena.blocks.begin() + next, (char *)malloc(size));
+            arena.blockSizes.insert(arena.blockSizes.begin() + next, size);
+            arena.stats.allocations++;
         }
+        arena.current = next;
+        arena.used = 0;
     }
-    else // Black pieces move down
+
+    void *result = arena.blocks[arena.current] + arena.used;
+    arena.used += bytes;
+    arena.stats.bytesInUse += bytes;
+    arena.stats.peakBytes = std::max(arena.stats.peakBytes, arena.stats.bytesInUse);
+    return result;
+}
+
+ArenaMark ArenaGetMark(const NodeArena &arena)
+{
+    ArenaMark mark;
+    mark.block = arena.current;
+    mark.used = arena.used;
+    mark.bytesInUse = arena.stats.bytesInUse;
+    return mark;
+}
+
+void ArenaRelease(NodeArena &arena, ArenaMark mark)
+{
+    // Nodes hold nothing that needs a destructor, so rewinding is all it takes
+    arena.current = mark.block;
+    arena.used = mark.used;
+    arena.stats.bytesInUse = mark.bytesInUse;
+}
+
+void ArenaReset(NodeArena &arena)
+{
+    arena.current = 0;
+    arena.used = 0;
+    arena.stats.bytesInUse = 0;
+}
+
+void ArenaFree(NodeArena &arena)
+{
+    for (unsigned int i = 0; i < arena.blocks.size(); i++)
     {
-        if (n->boardState[p.r + 1][p.c] == 'X')
-        {
-            return Point(p.r + 1, p.c);
-        }
-        else
-        {
-            return Point(-1, -1);
-        }
+        free(arena.blocks[i]);
     }
+    ArenaInit(arena, arena.blockSize);
 }
 
-Point CreateDiagonalPoint(Node *n, Point p, bool isLeftMove)
+void PrintMemoryStats(const char *allocator, const MemoryStats &stats)
 {
-    if (n->isWhitePlayer)
+    printf("Node Memory (%s): %llu nodes, %llu allocations, peak %llu bytes\n", allocator,
+           (unsigned long long)stats.nodes, (unsigned long long)stats.allocations, (unsigned long long)stats.peakBytes);
+}
+
+#ifdef SEARCH_STATS
+void StatsNode(int ply, bool terminal)
+{
+    g_searchStats.nodes[ply]++;
+    if (terminal)
     {
-        if (isLeftMove)
-        {
-            if (p.c - 1 < 0)
-            {
-                return Point(-1, -1);
-            }
-            else
-            {
-                if (n->boardState[p.r - 1][p.c - 1] == 'W') // Cannot capture yourself
-                {
-                    return Point(-1, -1);
-                }
-                else
-                {
-                    return Point(p.r - 1, p.c - 1);
-                }
-            }
-        }
-        else
-        {
-            if (p.c + 1 > 2)
-            {
-                return Point(-1, -1);
-            }
-            else
-            {
-                if (n->boardState[p.r - 1][p.c + 1] == 'W') // Cannot capture yourself
-                {
-                    return Point(-1, -1);
-                }
-                else
-                {
-                    return Point(p.r - 1, p.c + 1);
-                }
-            }
-        }
+        g_searchStats.terminal[ply]++;
     }
-    else
+    g_searchStats.deepestPly = std::max(g_searchStats.deepestPly, ply);
+}
+
+void StatsChildren(int ply, int numMoves)
+{
+    g_searchStats.children[ply] += numMoves;
+}
+
+void StatsCutoff(int ply, int index)
+{
+    g_searchStats.cutoffs[ply]++;
+    g_searchStats.cutoffAtIndex[ply][std::min(index, STATS_CUTOFF_INDICES - 1)]++;
+}
+
+void StatsReport(int rows, int cols)
+{
+    // The branching factor of a ply is how many children were searched per
+    // position that was not already won, so cutoffs bring it below the moves generated
+    const SearchStats &stats = g_searchStats;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stats.start).count();
+    uint64_t totalNodes = 0;
+    for (int ply = 0; ply <= stats.deepestPly; ply++)
     {
-        if (isLeftMove)
-        {
-            if (p.c - 1 < 0)
-            {
-                return Point(-1, -1);
-            }
-            else
-            {
-                if (n->boardState[p.r + 1][p.c - 1] == 'B') // Cannot capture yourself
-                {
-                    return Point(-1, -1);
-                }
-                else
-                {
-                    return Point(p.r + 1, p.c - 1);
-                }
-            }
-        }
-        else
+        totalNodes += stats.nodes[ply];
+    }
+
+    printf("{\n");
+    printf("  \"board\": [%d, %d],\n", rows, cols);
+    printf("  \"timeMs\": %.3f,\n", ms);
+    printf("  \"nodes\": %llu,\n", (unsigned long long)totalNodes);
+    printf("  \"nodesPerSecond\": %.0f,\n", ms > 0.0 ? totalNodes * 1000.0 / ms : 0.0);
+    printf("  \"plies\": [");
+    for (int ply = 0; ply <= stats.deepestPly && totalNodes > 0; ply++)
+    {
+        uint64_t nodes = stats.nodes[ply];
+        uint64_t expanded = nodes - stats.terminal[ply];
+        uint64_t nextNodes = (ply + 1 < MAX_PLY) ? stats.nodes[ply + 1] : 0;
+        printf("%s\n    {\"ply\": %d, \"nodes\": %llu, \"children\": %llu, \"cutoffs\": %llu, \"cutoffAtIndex\": [",
+               ply == 0 ? "" : ",", ply, (unsigned long long)nodes, (unsigned long long)stats.children[ply],
+               (unsigned long long)stats.cutoffs[ply]);
+        for (int i = 0; i < STATS_CUTOFF_INDICES; i++)
         {
-            if (p.c + 1 > 2)
-            {
-                return Point(-1, -1);
-            }
-            else
-            {
-                if (n->boardState[p.r + 1][p.c + 1] == 'B') // Cannot capture yourself
-                {
-                    return Point(-1, -1);
-                }
-                else
-                {
-                    return Point(p.r + 1, p.c + 1);
-                }
-            }
+            printf("%s%llu", i == 0 ? "" : ", ", (unsigned long long)stats.cutoffAtIndex[ply][i]);
         }
+        printf("], \"terminal\": %llu, \"branchingFactor\": %.3f}",
+               (unsigned long long)stats.terminal[ply], expanded > 0 ? (double)nextNodes / expanded : 0.0);
     }
+    printf("\n  ]\n}\n");
 }
+#endif
 
+template <int R, int C>
 void Tests(Node *startNode)
 {
     // Some Tests
@@ -668,57 +6196,57 @@ void Tests(Node *startNode)
     // 1. Test all win conditions
 
     // All P1 Conditions
-    LoadFile(startNode);
-    startNode->boardState[0][0] = 'W';
-    printf("%d\n", CheckWinCondition(startNode));
+    LoadFile<R, C>(startNode);
+    Board<R, C>::SetSquare(startNode->position, 0, 0, 'W');
+    printf("%d\n", Board<R, C>::CheckWinCondition(startNode->position));
 
-    LoadFile(startNode);
-    startNode->boardState[0][1] = 'W';
-    printf("%d\n", CheckWinCondition(startNode));
+    LoadFile<R, C>(startNode);
+    Board<R, C>::SetSquare(startNode->position, 0, 1, 'W');
+    printf("%d\n", Board<R, C>::CheckWinCondition(startNode->position));
 
-    LoadFile(startNode);
-    startNode->boardState[0][2] = 'W';
-    printf("%d\n", CheckWinCondition(startNode));
+    LoadFile<R, C>(startNode);
+    Board<R, C>::SetSquare(startNode->position, 0, 2, 'W');
+    printf("%d\n", Board<R, C>::CheckWinCondition(startNode->position));
 
     // All P2 Conditions
-    startNode->isWhitePlayer = !startNode->isWhitePlayer;
-    LoadFile(startNode);
-    startNode->boardState[5][0] = 'B';
-    printf("%d\n", CheckWinCondition(startNode));
+    startNode->position.isWhitePlayer = !startNode->position.isWhitePlayer;
+    LoadFile<R, C>(startNode);
+    Board<R, C>::SetSquare(startNode->position, 5, 0, 'B');
+    printf("%d\n", Board<R, C>::CheckWinCondition(startNode->position));
 
-    LoadFile(startNode);
-    startNode->boardState[5][1] = 'B';
-    printf("%d\n", CheckWinCondition(startNode));
+    LoadFile<R, C>(startNode);
+    Board<R, C>::SetSquare(startNode->position, 5, 1, 'B');
+    printf("%d\n", Board<R, C>::CheckWinCondition(startNode->position));
 
-    LoadFile(startNode);
-    startNode->boardState[5][2] = 'B';
-    printf("%d\n", CheckWinCondition(startNode));
+    LoadFile<R, C>(startNode);
+    Board<R, C>::SetSquare(startNode->position, 5, 2, 'B');
+    printf("%d\n", Board<R, C>::CheckWinCondition(startNode->position));
 
     // Check Capture condition wins
 
     // White Should Win
-    LoadFile(startNode);
-    startNode->boardState[0][0] = 'X';
-    startNode->boardState[0][1] = 'X';
-    startNode->boardState[0][2] = 'X';
-    startNode->boardState[1][0] = 'X';
-    startNode->boardState[1][1] = 'X';
-    startNode->boardState[1][2] = 'X';
-    printf("%d\n", CheckWinCondition(startNode));
+    LoadFile<R, C>(startNode);
+    Board<R, C>::SetSquare(startNode->position, 0, 0, 'X');
+    Board<R, C>::SetSquare(startNode->position, 0, 1, 'X');
+    Board<R, C>::SetSquare(startNode->position, 0, 2, 'X');
+    Board<R, C>::SetSquare(startNode->position, 1, 0, 'X');
+    Board<R, C>::SetSquare(startNode->position, 1, 1, 'X');
+    Board<R, C>::SetSquare(startNode->position, 1, 2, 'X');
+    printf("%d\n", Board<R, C>::CheckWinCondition(startNode->position));
 
     // Black Should Win
-    LoadFile(startNode);
-    startNode->boardState[4][0] = 'X';
-    startNode->boardState[4][1] = 'X';
-    startNode->boardState[4][2] = 'X';
-    startNode->boardState[5][0] = 'X';
-    startNode->boardState[5][1] = 'X';
-    startNode->boardState[5][2] = 'X';
-    printf("%d\n", CheckWinCondition(startNode));
+    LoadFile<R, C>(startNode);
+    Board<R, C>::SetSquare(startNode->position, 4, 0, 'X');
+    Board<R, C>::SetSquare(startNode->position, 4, 1, 'X');
+    Board<R, C>::SetSquare(startNode->position, 4, 2, 'X');
+    Board<R, C>::SetSquare(startNode->position, 5, 0, 'X');
+    Board<R, C>::SetSquare(startNode->position, 5, 1, 'X');
+    Board<R, C>::SetSquare(startNode->position, 5, 2, 'X');
+    printf("%d\n", Board<R, C>::CheckWinCondition(startNode->position));
 
     // There should be NO wins here
-    LoadFile(startNode);
-    printf("%d\n\n", CheckWinCondition(startNode));
+    LoadFile<R, C>(startNode);
+    printf("%d\n\n", Board<R, C>::CheckWinCondition(startNode->position));
 
     // Now Lets do some tests with checking tree expansions
 
@@ -727,17 +6255,17 @@ void Tests(Node *startNode)
     std::cout << "Basic Movement Tests" << std::endl;
 
     // Test Whites moves
-    LoadFileCustom(startNode, "InputTestAllValidMoves.txt");
-    startNode->isWhitePlayer = true;
-    FindAndMovePieces(startNode);
+    LoadFileCustom<R, C>(startNode, "InputTestAllValidMoves.txt");
+    startNode->position.isWhitePlayer = true;
+    FindAndMovePieces<R, C>(startNode);
 
     // Print out the parent board state, and then the children board states
     std::cout << "Board of White Player Parent" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -748,17 +6276,17 @@ void Tests(Node *startNode)
     startNode->children.clear();
 
     // Test Blacks moves
-    LoadFileCustom(startNode, "InputTestAllValidMoves.txt");
-    startNode->isWhitePlayer = false;
-    FindAndMovePieces(startNode);
+    LoadFileCustom<R, C>(startNode, "InputTestAllValidMoves.txt");
+    startNode->position.isWhitePlayer = false;
+    FindAndMovePieces<R, C>(startNode);
 
     // Print out the parent board state, and then the children board states
     std::cout << "Board of Black Player Parent" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -774,21 +6302,21 @@ void Tests(Node *startNode)
 
     std::cout << "Illegal Forward Movement Tests" << std::endl;
     // Test Whites moves
-    LoadFileCustom(startNode, "blank.txt");
-    startNode->isWhitePlayer = true;
+    LoadFileCustom<R, C>(startNode, "blank.txt");
+    startNode->position.isWhitePlayer = true;
 
-    startNode->boardState[5][1] = 'W';
-    startNode->boardState[4][1] = 'W';
+    Board<R, C>::SetSquare(startNode->position, 5, 1, 'W');
+    Board<R, C>::SetSquare(startNode->position, 4, 1, 'W');
 
-    FindAndMovePieces(startNode);
+    FindAndMovePieces<R, C>(startNode);
 
     // Print out the parent board state, and then the children board states
     std::cout << "Board of White Player Parent: W Case" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -798,17 +6326,17 @@ void Tests(Node *startNode)
     }
     startNode->children.clear();
 
-    startNode->boardState[4][1] = 'B';
+    Board<R, C>::SetSquare(startNode->position, 4, 1, 'B');
 
-    FindAndMovePieces(startNode);
+    FindAndMovePieces<R, C>(startNode);
 
     // Print out the parent board state, and then the children board states
     std::cout << "Board of White Player Parent: B Case" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -819,20 +6347,20 @@ void Tests(Node *startNode)
     startNode->children.clear();
 
     // Test Blacks moves
-    LoadFileCustom(startNode, "blank.txt");
-    startNode->isWhitePlayer = false;
+    LoadFileCustom<R, C>(startNode, "blank.txt");
+    startNode->position.isWhitePlayer = false;
 
-    startNode->boardState[0][1] = 'B';
-    startNode->boardState[1][1] = 'B';
-    FindAndMovePieces(startNode);
+    Board<R, C>::SetSquare(startNode->position, 0, 1, 'B');
+    Board<R, C>::SetSquare(startNode->position, 1, 1, 'B');
+    FindAndMovePieces<R, C>(startNode);
 
     // Print out the parent board state, and then the children board states
     std::cout << "Board of Black Player Parent: B Case" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -842,16 +6370,16 @@ void Tests(Node *startNode)
     }
     startNode->children.clear();
 
-    startNode->boardState[1][1] = 'W';
-    FindAndMovePieces(startNode);
+    Board<R, C>::SetSquare(startNode->position, 1, 1, 'W');
+    FindAndMovePieces<R, C>(startNode);
 
      // Print out the parent board state, and then the children board states
     std::cout << "Board of Black Player Parent: W Case" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -863,21 +6391,21 @@ void Tests(Node *startNode)
 
     std::cout << "Illegal Diagonal Movement Tests" << std::endl;
     // Test Whites moves
-    LoadFileCustom(startNode, "blank.txt");
-    startNode->isWhitePlayer = true;
+    LoadFileCustom<R, C>(startNode, "blank.txt");
+    startNode->position.isWhitePlayer = true;
 
-    startNode->boardState[5][0] = 'W';
-    startNode->boardState[5][2] = 'W';
+    Board<R, C>::SetSquare(startNode->position, 5, 0, 'W');
+    Board<R, C>::SetSquare(startNode->position, 5, 2, 'W');
 
-    FindAndMovePieces(startNode);
+    FindAndMovePieces<R, C>(startNode);
 
     // Print out the parent board state, and then the children board states
     std::cout << "Board of White Player Parent" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -889,21 +6417,21 @@ void Tests(Node *startNode)
 
 
     // Test Blacks moves
-    LoadFileCustom(startNode, "blank.txt");
-    startNode->isWhitePlayer = false;
+    LoadFileCustom<R, C>(startNode, "blank.txt");
+    startNode->position.isWhitePlayer = false;
 
-    startNode->boardState[0][0] = 'B';
-    startNode->boardState[0][2] = 'B';
+    Board<R, C>::SetSquare(startNode->position, 0, 0, 'B');
+    Board<R, C>::SetSquare(startNode->position, 0, 2, 'B');
 
-    FindAndMovePieces(startNode);
+    FindAndMovePieces<R, C>(startNode);
 
     // Print out the parent board state, and then the children board states
     std::cout << "Board of Black Player Parent" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -915,22 +6443,22 @@ void Tests(Node *startNode)
 
     std::cout << "Legal Capture Movement Tests" << std::endl;
     // Test Whites moves
-    LoadFileCustom(startNode, "blank.txt");
-    startNode->isWhitePlayer = true;
+    LoadFileCustom<R, C>(startNode, "blank.txt");
+    startNode->position.isWhitePlayer = true;
 
-    startNode->boardState[5][0] = 'W';
-    startNode->boardState[5][2] = 'W';
-    startNode->boardState[4][1] = 'B';
+    Board<R, C>::SetSquare(startNode->position, 5, 0, 'W');
+    Board<R, C>::SetSquare(startNode->position, 5, 2, 'W');
+    Board<R, C>::SetSquare(startNode->position, 4, 1, 'B');
 
-    FindAndMovePieces(startNode);
+    FindAndMovePieces<R, C>(startNode);
 
     // Print out the parent board state, and then the children board states
     std::cout << "Board of White Player Parent: Capture Black" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -942,22 +6470,22 @@ void Tests(Node *startNode)
 
 
     // Test Blacks moves
-    LoadFileCustom(startNode, "blank.txt");
-    startNode->isWhitePlayer = false;
+    LoadFileCustom<R, C>(startNode, "blank.txt");
+    startNode->position.isWhitePlayer = false;
 
-    startNode->boardState[0][0] = 'B';
-    startNode->boardState[0][2] = 'B';
-    startNode->boardState[1][1] = 'W';
+    Board<R, C>::SetSquare(startNode->position, 0, 0, 'B');
+    Board<R, C>::SetSquare(startNode->position, 0, 2, 'B');
+    Board<R, C>::SetSquare(startNode->position, 1, 1, 'W');
 
-    FindAndMovePieces(startNode);
+    FindAndMovePieces<R, C>(startNode);
 
     // Print out the parent board state, and then the children board states
     std::cout << "Board of Black Player Parent: Capture White" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -969,22 +6497,22 @@ void Tests(Node *startNode)
 
     std::cout << "Illegal Capture Movement Tests" << std::endl;
     // Test Whites moves
-    LoadFileCustom(startNode, "blank.txt");
-    startNode->isWhitePlayer = true;
+    LoadFileCustom<R, C>(startNode, "blank.txt");
+    startNode->position.isWhitePlayer = true;
 
-    startNode->boardState[5][0] = 'W';
-    startNode->boardState[5][2] = 'W';
-    startNode->boardState[4][1] = 'W';
+    Board<R, C>::SetSquare(startNode->position, 5, 0, 'W');
+    Board<R, C>::SetSquare(startNode->position, 5, 2, 'W');
+    Board<R, C>::SetSquare(startNode->position, 4, 1, 'W');
 
-    FindAndMovePieces(startNode);
+    FindAndMovePieces<R, C>(startNode);
 
     // Print out the parent board state, and then the children board states
     std::cout << "Board of White Player Parent: Capture Nothing" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -995,22 +6523,22 @@ void Tests(Node *startNode)
     startNode->children.clear();
 
     // Test Blacks moves
-    LoadFileCustom(startNode, "blank.txt");
-    startNode->isWhitePlayer = false;
+    LoadFileCustom<R, C>(startNode, "blank.txt");
+    startNode->position.isWhitePlayer = false;
 
-    startNode->boardState[0][0] = 'B';
-    startNode->boardState[0][2] = 'B';
-    startNode->boardState[1][1] = 'B';
+    Board<R, C>::SetSquare(startNode->position, 0, 0, 'B');
+    Board<R, C>::SetSquare(startNode->position, 0, 2, 'B');
+    Board<R, C>::SetSquare(startNode->position, 1, 1, 'B');
 
-    FindAndMovePieces(startNode);
+    FindAndMovePieces<R, C>(startNode);
 
     // Print out the parent board state, and then the children board states
     std::cout << "Board of Black Player Parent: Capture Nothing" << std::endl;
-    PrintList(startNode);
+    PrintList<R, C>(startNode);
     for (unsigned int i = 0; i < startNode->children.size(); i++)
     {
         std::cout << "Board of child " << i << std::endl;
-        PrintList(startNode->children[i]);
+        PrintList<R, C>(startNode->children[i]);
     }
 
     // Delete all of the children
@@ -0,0 +1,67 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Solve a board in process and get the answer back as data instead of text.  Build
+// main.cpp with -DSOLVER_LIBRARY to leave out the command line program and link it
+// into anything that includes this header.  Solve can be called from any number of
+// threads at once: every call searches with its own tables and counters.  That
+// table costs a ttMegabytes allocation and clear per call (around a millisecond
+// for the default 16 MB), so a caller solving many boards should keep a
+// SolverContext instead, whose tables stay warm from one call to the next.
+
+// Move ordering policies, each one adds to the one before it
+enum OrderPolicy
+{
+    ORDER_NONE,              // Generation order
+    ORDER_TACTICAL,          // Winning and promotion moves, then captures
+    ORDER_KILLERS,           // ... then the killer moves for this ply
+    ORDER_HISTORY,           // ... then the rest by history score
+    NUM_ORDER_POLICIES
+};
+
+struct SearchOptions
+{
+    int ttMegabytes;         // Transposition table made for the call, 0 for none (and a principal variation of one move)
+    bool mirror;             // Share table entries between a position and its left-right mirror
+    OrderPolicy order;       // Move ordering of the search
+    bool race;               // Stop at positions where the side to move has a pawn that can not be stopped
+};
+
+struct SolveMove
+{
+    int fromRow;
+    int fromCol;
+    int toRow;
+    int toCol;
+};
+
+struct SolveResult
+{
+    bool solved;             // False if the board could not be searched, error says why
+    std::string error;
+    int value;               // 1 if Player A (White, to move) wins, -1 if Player B does
+    bool hasMove;            // False if the game is already over
+    SolveMove best;          // Player A's move: the first one that wins, or the last one tried
+    std::vector<SolveMove> pv; // best, then the replies and answers the table holds, to the end of the game
+    uint64_t nodes;          // Positions searched
+    uint64_t tableProbes;
+    uint64_t tableHits;
+    double milliseconds;
+};
+
+// Tables kept between Solve calls, one per board size (and mirror setting), made
+// on first use with that call's ttMegabytes.  A solved position stays solved, so
+// reusing them is always safe.  One context is for one thread at a time.
+struct SolverContext;
+
+void SearchOptionsInit(SearchOptions &); // The options the command line uses with --tt 16
+SolveResult Solve(const std::vector<std::string> &rows, const SearchOptions &); // Rows of B, W and X (empty), top row first, White to move
+SolverContext *SolverCreate(); // A context with no tables yet
+SolveResult Solve(SolverContext *, const std::vector<std::string> &rows, const SearchOptions &); // Same, searching with the context's warm table
+void SolverDestroy(SolverContext *); // Free the context and its tables
+
+#endif // SOLVER_H